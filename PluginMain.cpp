@@ -15,6 +15,9 @@
 #include "smearControlNode.h"
 #include "motionLinesNode.h"
 #include "loadCacheCmd.h"
+#include "smearBakeCmd.h"
+#include "smearStatsCmd.h"
+#include "smearStats.h"
 
 /*
 ================================================================================
@@ -69,6 +72,12 @@ MStatus initializePlugin(MObject obj) {
     MStatus   status = MStatus::kSuccess;
     MFnPlugin plugin(obj, "SMEARin", "1.0", "Any");
 
+    SmearProfiler::registerCategory();
+
+    status = Smear::watchTimeUnit();
+    if (!status)
+        MGlobal::displayWarning("SMEARin: could not watch the time unit, caches will not follow frame rate changes");
+
     status = plugin.registerNode(
         "SmearNode", 
         SmearNode::id,
@@ -117,7 +126,9 @@ MStatus initializePlugin(MObject obj) {
         return status;
     }
 
-    plugin.registerCommand("loadCache", LoadCacheCmd::creator);
+    plugin.registerCommand("loadCache", LoadCacheCmd::creator, LoadCacheCmd::newSyntax);
+    plugin.registerCommand("smearBake", SmearBakeCmd::creator, SmearBakeCmd::newSyntax);
+    plugin.registerCommand("smearStats", SmearStatsCmd::creator, SmearStatsCmd::newSyntax);
 
 
     MGlobal::executePythonCommand(R"(
@@ -168,6 +179,11 @@ MStatus uninitializePlugin(MObject obj) {
     }
 
     plugin.deregisterCommand("loadCache");
+    plugin.deregisterCommand("smearBake");
+    plugin.deregisterCommand("smearStats");
+
+    SmearProfiler::deregisterCategory();
+    Smear::unwatchTimeUnit();
 
 
     return MStatus::kSuccess;
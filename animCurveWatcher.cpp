@@ -0,0 +1,189 @@
+#include "animCurveWatcher.h"
+#include "smear.h"
+#include "nodePreparation.h"
+#include <maya/MFnAnimCurve.h>
+#include <maya/MFnDependencyNode.h>
+#include <maya/MGlobal.h>
+#include <maya/MTime.h>
+#include <algorithm>
+#include <climits>
+
+AnimCurveWatcher::AnimCurveWatcher() :
+    m_startFrame(0), m_endFrame(-1), m_watching(false), m_connectionsChanged(false)
+{}
+
+AnimCurveWatcher::~AnimCurveWatcher()
+{
+    clear();
+}
+
+MStatus AnimCurveWatcher::watch(const MDagPath& transformPath, const MObject& node, int startFrame, int endFrame)
+{
+    MStatus status;
+    clear();
+
+    MObjectArray curveNodes;
+    status = Smear::findAnimCurves(transformPath, curveNodes);
+
+    // Sampled outside the lock, which only needs to cover the swap
+    const int numFrames = std::max(0, endFrame - startFrame + 1);
+    std::vector<Curve> curves(status ? curveNodes.length() : 0);
+    for (unsigned int i = 0; i < curves.size(); ++i) {
+        Curve& curve = curves[i];
+        curve.node = curveNodes[i];
+        MFnAnimCurve curveFn(curve.node);
+        curve.samples.resize(numFrames);
+        for (int f = 0; f < numFrames; ++f)
+            curve.samples[f] = curveFn.evaluate(MTime(startFrame + f, MTime::uiUnit()));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_transformPath = transformPath;
+        m_node = MObjectHandle(node);
+        m_startFrame = startFrame;
+        m_endFrame = endFrame;
+        m_curves = std::move(curves);
+        // Even when the callbacks fail the bake stands, it just won't follow key edits
+        m_watching = true;
+    }
+    if (!status)
+        return status;
+
+    for (Curve& curve : m_curves) {
+        MCallbackId id = MNodeMessage::addAttributeChangedCallback(curve.node, curveChanged, this, &status);
+        if (!status) {
+            MFnDependencyNode curveFn(curve.node);
+            MGlobal::displayWarning("Smear: could not watch anim curve " + curveFn.name() + ", key edits will not re-bake");
+            continue;
+        }
+        m_callbacks.append(id);
+    }
+
+    MObject transformNode = transformPath.node();
+    MCallbackId id = MNodeMessage::addAttributeChangedCallback(transformNode, transformChanged, this, &status);
+    if (status)
+        m_callbacks.append(id);
+    return MS::kSuccess;
+}
+
+void AnimCurveWatcher::clear()
+{
+    if (m_callbacks.length() > 0)
+        MMessage::removeCallbacks(m_callbacks);
+    m_callbacks.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_curves.clear();
+        m_watching = false;
+    }
+    m_connectionsChanged = false;
+}
+
+AnimCurveWatcher::Change AnimCurveWatcher::poll(const MDagPath& transformPath, int& firstIndex, int& lastIndex)
+{
+    firstIndex = 0;
+    lastIndex = -1;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // The input was reconnected to another transform since the bake
+    if (!m_watching || !(m_transformPath == transformPath))
+        return Change::All;
+
+    if (m_connectionsChanged.exchange(false)) {
+        if (!curvesMatch())
+            return Change::All;
+    }
+
+    bool anyDirty = false;
+    for (const Curve& curve : m_curves)
+        anyDirty = anyDirty || curve.dirty;
+    if (!anyDirty)
+        return Change::None;
+    if (!rangeMatches())
+        return Change::All;
+
+    int first = INT_MAX;
+    int last = -1;
+    for (Curve& curve : m_curves) {
+        if (!curve.dirty.exchange(false))
+            continue;
+
+        MStatus status;
+        MFnAnimCurve curveFn(curve.node, &status);
+        if (!status)
+            return Change::All;
+
+        // Exact comparison on purpose: frames the edit did not reach evaluate to the same value
+        for (int f = 0; f < static_cast<int>(curve.samples.size()); ++f) {
+            const double value = curveFn.evaluate(MTime(m_startFrame + f, MTime::uiUnit()));
+            if (value != curve.samples[f]) {
+                curve.samples[f] = value;
+                first = std::min(first, f);
+                last = std::max(last, f);
+            }
+        }
+    }
+
+    if (last < 0)
+        return Change::None;
+    firstIndex = first;
+    lastIndex = last;
+    return Change::Frames;
+}
+
+void AnimCurveWatcher::curveChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData)
+{
+    // Keys being set, added or removed; evaluations of the curve are not edits
+    const int editMask = MNodeMessage::kAttributeSet | MNodeMessage::kAttributeArrayAdded | MNodeMessage::kAttributeArrayRemoved;
+    if (!(msg & editMask))
+        return;
+
+    AnimCurveWatcher* watcher = static_cast<AnimCurveWatcher*>(clientData);
+    MObject curveNode = plug.node();
+    {
+        std::lock_guard<std::mutex> lock(watcher->m_mutex);
+        for (Curve& curve : watcher->m_curves) {
+            if (curve.node == curveNode)
+                curve.dirty = true;
+        }
+    }
+    watcher->requestEvaluation();
+}
+
+void AnimCurveWatcher::transformChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData)
+{
+    if (!(msg & (MNodeMessage::kConnectionMade | MNodeMessage::kConnectionBroken)))
+        return;
+
+    AnimCurveWatcher* watcher = static_cast<AnimCurveWatcher*>(clientData);
+    watcher->m_connectionsChanged = true;
+    watcher->requestEvaluation();
+}
+
+void AnimCurveWatcher::requestEvaluation()
+{
+    // The node's inputs did not change; its preparation re-bakes and dirties it once the edit is done
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_node.isValid())
+        PreparedNode::request(m_node.object());
+}
+
+bool AnimCurveWatcher::curvesMatch() const
+{
+    MObjectArray curveNodes;
+    if (!Smear::findAnimCurves(m_transformPath, curveNodes) || curveNodes.length() != m_curves.size())
+        return false;
+    for (unsigned int i = 0; i < curveNodes.length(); ++i) {
+        if (curveNodes[i] != m_curves[i].node)
+            return false;
+    }
+    return true;
+}
+
+bool AnimCurveWatcher::rangeMatches() const
+{
+    double startFrame, endFrame;
+    if (!Smear::extractAnimationFrameRange(m_transformPath, startFrame, endFrame))
+        return false;
+    return static_cast<int>(startFrame) == m_startFrame && static_cast<int>(endFrame) == m_endFrame;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <maya/MObject.h>
+#include <maya/MObjectArray.h>
+#include <maya/MObjectHandle.h>
+#include <maya/MDagPath.h>
+#include <maya/MPlug.h>
+#include <maya/MNodeMessage.h>
+#include <maya/MCallbackIdArray.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/*
+Tracks the anim curves driving a baked transform and reports which frames their
+edits touched, so only those frames need to be baked again.
+
+watch() samples every curve at each frame of the bake. Key edits only flag the
+curve from its attribute-changed callback and request a preparation of the
+owning node (see PreparedNode); the curve is re-sampled and compared when that
+runs and calls poll(), so dragging a key costs nothing until then. Curves being
+connected to or disconnected from the transform, or keys moving the animation
+range, ask for a full bake instead.
+*/
+
+class AnimCurveWatcher
+{
+public:
+    enum class Change {
+        None,   // Nothing was edited
+        Frames, // Curve values changed on a span of frames
+        All     // Not watching this transform yet, or the set of curves or the range changed
+    };
+
+    AnimCurveWatcher();
+    ~AnimCurveWatcher();
+    AnimCurveWatcher(const AnimCurveWatcher&) = delete;
+    AnimCurveWatcher& operator=(const AnimCurveWatcher&) = delete;
+
+    // Starts watching the curves driving transformPath over [startFrame, endFrame]; node is prepared again on edits
+    MStatus watch(const MDagPath& transformPath, const MObject& node, int startFrame, int endFrame);
+    void clear();
+
+    // Frame indices (0 = startFrame) whose sampled curve values on transformPath changed since the last poll
+    Change poll(const MDagPath& transformPath, int& firstIndex, int& lastIndex);
+
+private:
+    struct Curve {
+        MObject node;
+        std::vector<double> samples;
+        // Set by curveChanged, cleared by poll when the node is prepared
+        std::atomic<bool> dirty{ false };
+    };
+
+    static void curveChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData);
+    static void transformChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData);
+    void requestEvaluation();
+    bool curvesMatch() const;
+    bool rangeMatches() const;
+
+    // Guards what watch() replaces while the callbacks may be reading it
+    std::mutex m_mutex;
+    MDagPath m_transformPath;
+    MObjectHandle m_node;
+    std::vector<Curve> m_curves;
+    int m_startFrame;
+    int m_endFrame;
+    bool m_watching;
+    MCallbackIdArray m_callbacks;
+    // Set from the callbacks, read when the node is prepared
+    std::atomic<bool> m_connectionsChanged;
+};
@@ -0,0 +1,134 @@
+#include "catmullRom.h"
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+/*
+Times trajectory sampling the way the deformer does it: every vertex gets its
+own base frame and spline parameter.
+
+    reference  the per-vertex path the nodes used before, double precision
+               points combined with float weights (Smear::catmullRomInterpolate)
+    scalar/sse/avx2  sampleTrajectories with a fixed implementation
+
+Usage: catmullRomBenchmark [vertexCount] [frameCount] [iterations]
+*/
+
+namespace {
+    struct Point3d {
+        double x, y, z;
+    };
+
+    Point3d toPoint(const float* p)
+    {
+        return { p[0], p[1], p[2] };
+    }
+
+    Point3d referenceInterpolate(const Point3d& p0, const Point3d& p1, const Point3d& p2, const Point3d& p3, float t)
+    {
+        const float t2 = t * t;
+        const float t3 = t2 * t;
+        const float a0 = -0.5f * t3 + t2 - 0.5f * t;
+        const float a1 = 1.5f * t3 - 2.5f * t2 + 1.0f;
+        const float a2 = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
+        const float a3 = 0.5f * t3 - 0.5f * t2;
+        return {
+            p0.x * a0 + p1.x * a1 + p2.x * a2 + p3.x * a3,
+            p0.y * a0 + p1.y * a1 + p2.y * a2 + p3.y * a3,
+            p0.z * a0 + p1.z * a1 + p2.z * a2 + p3.z * a3
+        };
+    }
+
+    void sampleReference(const FrameStore& frames, const int* vertexIds, const int* baseFrames, const float* t,
+        int count, std::vector<Point3d>& out)
+    {
+        for (int i = 0; i < count; ++i) {
+            const int v = vertexIds[i];
+            const Point3d p0 = toPoint(frames.position(frames.clampFrame(baseFrames[i] - 1), v));
+            const Point3d p1 = toPoint(frames.position(frames.clampFrame(baseFrames[i]), v));
+            const Point3d p2 = toPoint(frames.position(frames.clampFrame(baseFrames[i] + 1), v));
+            const Point3d p3 = toPoint(frames.position(frames.clampFrame(baseFrames[i] + 2), v));
+            out[i] = referenceInterpolate(p0, p1, p2, p3, t[i]);
+        }
+    }
+
+    template <typename Fn>
+    double millisecondsPerRun(int iterations, Fn&& fn)
+    {
+        fn(); // warm up caches and the dispatch
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            fn();
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / iterations;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int vertexCount = argc > 1 ? std::atoi(argv[1]) : 200000;
+    const int frameCount = argc > 2 ? std::atoi(argv[2]) : 120;
+    const int iterations = argc > 3 ? std::atoi(argv[3]) : 50;
+
+    FrameStore frames;
+    frames.allocate(1, frameCount, vertexCount);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> coord(-10.0f, 10.0f);
+    for (int f = 0; f < frameCount; ++f) {
+        float* positions = frames.mutablePositions(f);
+        for (int i = 0; i < vertexCount * 3; ++i)
+            positions[i] = coord(rng);
+    }
+
+    // Every vertex samples around the middle of the clip with its own offset, as the deformer does
+    std::vector<int> vertexIds(vertexCount), baseFrames(vertexCount);
+    std::vector<float> t(vertexCount);
+    std::uniform_real_distribution<double> beta(-3.0, 3.0);
+    for (int i = 0; i < vertexCount; ++i) {
+        const double b = beta(rng);
+        vertexIds[i] = i;
+        baseFrames[i] = frameCount / 2 + static_cast<int>(std::floor(b));
+        t[i] = static_cast<float>(b - std::floor(b));
+    }
+
+    std::vector<Point3d> reference(vertexCount);
+    std::vector<float> out(static_cast<size_t>(vertexCount) * 3);
+
+    std::printf("%d vertices, %d frames, %d iterations\n", vertexCount, frameCount, iterations);
+    const double referenceMs = millisecondsPerRun(iterations, [&] {
+        sampleReference(frames, vertexIds.data(), baseFrames.data(), t.data(), vertexCount, reference);
+    });
+    std::printf("%-10s %8.3f ms\n", "reference", referenceMs);
+
+    struct Variant {
+        const char* name;
+        CatmullRomPath path;
+    };
+    const Variant variants[] = {
+        { "scalar", CatmullRomPath::Scalar },
+        { "sse", CatmullRomPath::SSE },
+        { "avx2", CatmullRomPath::AVX2 },
+    };
+    for (const Variant& variant : variants) {
+        if (variant.path > bestCatmullRomPath()) {
+            std::printf("%-10s not supported on this CPU\n", variant.name);
+            continue;
+        }
+        const double ms = millisecondsPerRun(iterations, [&] {
+            sampleTrajectories(variant.path, frames, vertexIds.data(), baseFrames.data(), t.data(), vertexCount, out.data());
+        });
+
+        double maxError = 0.0;
+        for (int i = 0; i < vertexCount; ++i) {
+            maxError = std::max(maxError, std::abs(out[i * 3 + 0] - reference[i].x));
+            maxError = std::max(maxError, std::abs(out[i * 3 + 1] - reference[i].y));
+            maxError = std::max(maxError, std::abs(out[i * 3 + 2] - reference[i].z));
+        }
+        std::printf("%-10s %8.3f ms  %5.2fx  max error %g\n", variant.name, ms, referenceMs / ms, maxError);
+    }
+    return 0;
+}
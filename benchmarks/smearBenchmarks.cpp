@@ -0,0 +1,310 @@
+#include "catmullRom.h"
+#include "frameStore.h"
+#include "seedSelection.h"
+#include "smearDeltas.h"
+#include "smearMotion.h"
+#include "smoothedOffsets.h"
+#include "subframeSampling.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+The bake -> smooth -> deform pipeline on synthetic data, without Maya.
+
+    BM_BakeSimple        computeSimpleOffsets for a sphere flying along an arc
+    BM_BakeArticulated   computeArticulatedDeltas for a swinging chain of bones
+    BM_Smooth            SmoothedOffsets::update, per smoothing window
+    BM_Deform            elongationSample + sampleTrajectories for one frame
+    BM_Subframes         five motion-blur sub-samples of a frame, one by one or batched
+    BM_CacheLoad         FrameStore::load of a baked cache from disk
+    BM_SelectSeeds       selectMotionLineSeeds, 100 motion lines
+    BM_DecodeWindow      decoding the 9 frames a compressed cache is sampled from
+    BM_PlaybackWindow    FrameWindow::view following playback over a compressed cache
+
+Arguments are vertex counts (and the window for BM_Smooth, batching for BM_Subframes).
+*/
+
+namespace {
+    const int kFrameCount = 120;
+    const double kPi = 3.14159265358979323846;
+
+    // Rings of points on a unit sphere, roughly what a polySphere looks like
+    std::vector<float> spherePoints(int vertexCount)
+    {
+        std::vector<float> points(static_cast<size_t>(vertexCount) * 3);
+        const double golden = kPi * (3.0 - std::sqrt(5.0));
+        for (int i = 0; i < vertexCount; ++i) {
+            const double y = 1.0 - 2.0 * (i + 0.5) / vertexCount;
+            const double r = std::sqrt(1.0 - y * y);
+            points[i * 3 + 0] = static_cast<float>(r * std::cos(golden * i));
+            points[i * 3 + 1] = static_cast<float>(y);
+            points[i * 3 + 2] = static_cast<float>(r * std::sin(golden * i));
+        }
+        return points;
+    }
+
+    // A rigid arc with some spin, row-major and in Maya's p * M convention
+    std::vector<double> arcMatrices(int frameCount)
+    {
+        std::vector<double> matrices(static_cast<size_t>(frameCount) * 16, 0.0);
+        for (int f = 0; f < frameCount; ++f) {
+            double* m = &matrices[static_cast<size_t>(f) * 16];
+            const double angle = 0.1 * f;
+            m[0] = std::cos(angle);  m[2] = -std::sin(angle);
+            m[5] = 1.0;
+            m[8] = std::sin(angle);  m[10] = std::cos(angle);
+            m[12] = 10.0 * std::cos(f * 0.05);
+            m[13] = 4.0 * std::sin(f * 0.1);
+            m[14] = 0.5 * f;
+            m[15] = 1.0;
+        }
+        return matrices;
+    }
+
+    // A baked simple object: world positions plus normalised offsets for every frame
+    void bakeSphere(int vertexCount, FrameStore& frames)
+    {
+        const std::vector<float> rest = spherePoints(vertexCount);
+        const std::vector<double> matrices = arcMatrices(kFrameCount);
+        frames.allocate(1, kFrameCount, vertexCount);
+        for (int f = 0; f < kFrameCount; ++f) {
+            const double* m = &matrices[static_cast<size_t>(f) * 16];
+            float* out = frames.mutablePositions(f);
+            for (int v = 0; v < vertexCount; ++v) {
+                const float* p = &rest[static_cast<size_t>(v) * 3];
+                for (int c = 0; c < 3; ++c)
+                    out[v * 3 + c] = static_cast<float>(p[0] * m[c] + p[1] * m[4 + c] + p[2] * m[8 + c] + m[12 + c]);
+            }
+        }
+        std::vector<float> offsets(static_cast<size_t>(kFrameCount) * vertexCount);
+        computeSimpleOffsets(rest.data(), vertexCount, matrices.data(), kFrameCount, 0, kFrameCount - 1, offsets.data());
+        for (int f = 0; f < kFrameCount; ++f)
+            std::copy_n(&offsets[static_cast<size_t>(f) * vertexCount], vertexCount, frames.mutableOffsets(f));
+    }
+
+    void BM_BakeSimple(benchmark::State& state)
+    {
+        const int vertexCount = static_cast<int>(state.range(0));
+        const std::vector<float> rest = spherePoints(vertexCount);
+        const std::vector<double> matrices = arcMatrices(kFrameCount);
+        std::vector<float> offsets(static_cast<size_t>(kFrameCount) * vertexCount);
+        for (auto _ : state) {
+            computeSimpleOffsets(rest.data(), vertexCount, matrices.data(), kFrameCount, 0, kFrameCount - 1, offsets.data());
+            benchmark::DoNotOptimize(offsets.data());
+        }
+        state.SetItemsProcessed(state.iterations() * kFrameCount * vertexCount);
+    }
+
+    void BM_BakeArticulated(benchmark::State& state)
+    {
+        const int vertexCount = static_cast<int>(state.range(0));
+        const int boneCount = 8;
+
+        // A chain along y swinging about z, vertices skinned to their two nearest bones
+        std::vector<float> positions(static_cast<size_t>(kFrameCount) * vertexCount * 3);
+        std::vector<BonePose> poses(static_cast<size_t>(kFrameCount) * boneCount);
+        std::vector<float> weights(static_cast<size_t>(vertexCount) * boneCount, 0.0f);
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<float> jitter(-0.3f, 0.3f);
+        std::vector<float> heights(vertexCount);
+        for (int v = 0; v < vertexCount; ++v) {
+            heights[v] = static_cast<float>(boneCount) * (v + 0.5f) / vertexCount;
+            const int bone = std::min(static_cast<int>(heights[v]), boneCount - 1);
+            const float t = heights[v] - bone;
+            weights[static_cast<size_t>(v) * boneCount + bone] = 1.0f - 0.5f * t;
+            weights[static_cast<size_t>(v) * boneCount + std::min(bone + 1, boneCount - 1)] += 0.5f * t;
+        }
+        for (int f = 0; f < kFrameCount; ++f) {
+            const float swing = 0.4f * static_cast<float>(std::sin(f * 0.15));
+            for (int b = 0; b < boneCount; ++b) {
+                BonePose& pose = poses[static_cast<size_t>(f) * boneCount + b];
+                const float a = swing * b / boneCount;
+                pose.head[0] = std::sin(a) * b; pose.head[1] = std::cos(a) * b; pose.head[2] = 0.0f;
+                pose.tail[0] = std::sin(a) * (b + 1); pose.tail[1] = std::cos(a) * (b + 1); pose.tail[2] = 0.0f;
+            }
+            float* p = &positions[static_cast<size_t>(f) * vertexCount * 3];
+            for (int v = 0; v < vertexCount; ++v) {
+                const float a = swing * heights[v] / boneCount;
+                p[v * 3 + 0] = std::sin(a) * heights[v] + jitter(rng);
+                p[v * 3 + 1] = std::cos(a) * heights[v];
+                p[v * 3 + 2] = jitter(rng);
+            }
+        }
+
+        std::vector<float> offsets(static_cast<size_t>(kFrameCount) * vertexCount);
+        for (auto _ : state) {
+            computeArticulatedDeltas(positions.data(), poses.data(), weights.data(), kFrameCount, vertexCount, boneCount,
+                2, offsets.data());
+            benchmark::DoNotOptimize(offsets.data());
+        }
+        state.SetItemsProcessed(state.iterations() * kFrameCount * vertexCount);
+    }
+
+    void BM_Smooth(benchmark::State& state)
+    {
+        const int vertexCount = static_cast<int>(state.range(0));
+        const int window = static_cast<int>(state.range(1));
+        FrameStore frames;
+        bakeSphere(vertexCount, frames);
+        for (auto _ : state) {
+            SmoothedOffsets smoothed;
+            smoothed.update(frames, window);
+            benchmark::DoNotOptimize(smoothed.offsets(0));
+        }
+        state.SetItemsProcessed(state.iterations() * kFrameCount * vertexCount);
+    }
+
+    // One evaluation of the simple deformer: per-vertex sample, then the batched spline kernel
+    void BM_Deform(benchmark::State& state)
+    {
+        const int vertexCount = static_cast<int>(state.range(0));
+        FrameStore frames;
+        bakeSphere(vertexCount, frames);
+        SmoothedOffsets smoothed;
+        smoothed.update(frames, 2);
+
+        const int frameIndex = kFrameCount / 2;
+        std::vector<int> vertexIds(vertexCount), baseFrames(vertexCount);
+        std::vector<float> t(vertexCount), out(static_cast<size_t>(vertexCount) * 3);
+        for (auto _ : state) {
+            const float* offsets = smoothed.offsets(frameIndex);
+            for (int v = 0; v < vertexCount; ++v) {
+                const ElongationSample sample = elongationSample(offsets[v], 2.0, 2.0, frameIndex);
+                vertexIds[v] = v;
+                baseFrames[v] = sample.baseFrame;
+                t[v] = sample.t;
+            }
+            sampleTrajectories(frames, vertexIds.data(), baseFrames.data(), t.data(), vertexCount, out.data());
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetItemsProcessed(state.iterations() * vertexCount);
+    }
+
+    // The deformer during a 5-sample motion-blur render, with subframeSamples at 1 or 5
+    void BM_Subframes(benchmark::State& state)
+    {
+        const int vertexCount = static_cast<int>(state.range(0));
+        const Shutter shutter{ 0.0, 0.8, state.range(1) ? 5 : 1 };
+        FrameStore frames;
+        bakeSphere(vertexCount, frames);
+        SmoothedOffsets smoothed;
+        smoothed.update(frames, 2);
+
+        const ElongationParams params{ 2.0, 2.0, ElongationMode::Simple };
+        std::vector<int> vertexIds(vertexCount);
+        for (int v = 0; v < vertexCount; ++v)
+            vertexIds[v] = v;
+        std::vector<float> out(static_cast<size_t>(vertexCount) * 3);
+        SubframeBatch batch;
+        int frame = 0;
+        for (auto _ : state) {
+            // A new frame each iteration, so batches are never reused across iterations
+            const double frameTime = 10.0 + (frame++ % (kFrameCount - 20));
+            for (int s = 0; s < 5; ++s) {
+                const double time = frameTime + s * 0.2;
+                if (shutter.samples > 1) {
+                    benchmark::DoNotOptimize(batch.positions(frames, smoothed, params, vertexIds.data(), vertexCount, time, shutter));
+                }
+                else {
+                    sampleElongated(frames, smoothed, params, vertexIds.data(), vertexCount, &time, 1, out.data());
+                    benchmark::DoNotOptimize(out.data());
+                }
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * vertexCount * 5);
+    }
+
+    void BM_CacheLoad(benchmark::State& state)
+    {
+        const int vertexCount = static_cast<int>(state.range(0));
+        const std::string path = "smearBenchmarks_" + std::to_string(vertexCount) + ".smc";
+        std::string error;
+        {
+            FrameStore frames;
+            bakeSphere(vertexCount, frames);
+            if (!frames.write(path, error)) {
+                state.SkipWithError(error.c_str());
+                return;
+            }
+        }
+        for (auto _ : state) {
+            FrameStore frames;
+            if (!frames.load(path, error)) {
+                state.SkipWithError(error.c_str());
+                break;
+            }
+            benchmark::DoNotOptimize(frames.offsets(0));
+        }
+        std::remove(path.c_str());
+    }
+
+    void BM_SelectSeeds(benchmark::State& state)
+    {
+        const int vertexCount = static_cast<int>(state.range(0));
+        FrameStore frames;
+        bakeSphere(vertexCount, frames);
+        for (auto _ : state) {
+            std::vector<int> seeds = selectMotionLineSeeds(frames, 100);
+            benchmark::DoNotOptimize(seeds.data());
+        }
+        state.SetItemsProcessed(state.iterations() * vertexCount);
+    }
+
+    void BM_DecodeWindow(benchmark::State& state)
+    {
+        const int vertexCount = static_cast<int>(state.range(0));
+        const int windowFrames = 9;
+        FrameStore frames;
+        bakeSphere(vertexCount, frames);
+        CompressionSettings settings;
+        settings.enabled = true;
+        settings.positionTolerance = 0.001;
+        frames.compress(settings);
+        state.counters["bytes"] = static_cast<double>(frames.byteSize());
+
+        FrameStore window;
+        for (auto _ : state) {
+            frames.decodeWindow(kFrameCount / 2, kFrameCount / 2 + windowFrames - 1, window);
+            benchmark::DoNotOptimize(window.positions(0));
+        }
+        state.SetItemsProcessed(state.iterations() * windowFrames * vertexCount);
+    }
+
+    // One playback frame: the 9-frame window moves on by one
+    void BM_PlaybackWindow(benchmark::State& state)
+    {
+        const int vertexCount = static_cast<int>(state.range(0));
+        auto frames = std::make_shared<FrameStore>();
+        bakeSphere(vertexCount, *frames);
+        CompressionSettings settings;
+        settings.enabled = true;
+        settings.positionTolerance = 0.001;
+        frames->compress(settings);
+        const std::shared_ptr<const FrameStore> store = frames;
+
+        FrameWindow window;
+        int frame = 0;
+        for (auto _ : state) {
+            const int sampleFrame = 4 + (frame++ % (kFrameCount - 8));
+            benchmark::DoNotOptimize(window.view(store, sampleFrame - 4, sampleFrame + 4).positions(0));
+        }
+        state.SetItemsProcessed(state.iterations() * vertexCount);
+    }
+}
+
+BENCHMARK(BM_BakeSimple)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BakeArticulated)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Smooth)->Args({ 100000, 0 })->Args({ 100000, 2 })->Args({ 100000, 8 })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Deform)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Subframes)->Args({ 100000, 0 })->Args({ 100000, 1 })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CacheLoad)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SelectSeeds)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DecodeWindow)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PlaybackWindow)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,259 @@
+#include "cacheRegistry.h"
+#include "catmullRom.h"
+#include "smearCacheJson.h"
+#include <cmath>
+
+std::mutex CacheRegistry::mutex;
+std::list<CacheRegistry::Entry> CacheRegistry::entries;
+std::unordered_map<std::string, std::list<CacheRegistry::Entry>::iterator> CacheRegistry::index;
+std::unordered_map<std::string, std::shared_ptr<CacheRegistry::Load>> CacheRegistry::loading;
+size_t CacheRegistry::memoryBudget = CacheRegistry::kDefaultBudget;
+CompressionSettings CacheRegistry::compressionSettings;
+double CacheRegistry::targetFrameRate = 0.0;
+size_t CacheRegistry::hits = 0;
+size_t CacheRegistry::misses = 0;
+
+CacheRegistry::Handle CacheRegistry::acquire(const std::string& path, std::string& error)
+{
+    std::promise<Loaded> promise;
+    std::shared_ptr<Load> pending;
+    bool loader = false;
+    double frameRate;
+    CompressionSettings compression;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto found = index.find(path);
+        if (found != index.end()) {
+            auto it = found->second;
+            Handle handle = it->live.lock();
+            if (handle && it->frameRate == targetFrameRate) {
+                it->retained = handle;
+                entries.splice(entries.begin(), entries, it);
+                ++hits;
+                return handle;
+            }
+            entries.erase(it);
+            index.erase(found);
+        }
+
+        auto inFlight = loading.find(path);
+        if (inFlight != loading.end()) {
+            // Served by the load already reading it
+            ++hits;
+            pending = inFlight->second;
+        }
+        else {
+            ++misses;
+            pending = std::make_shared<Load>();
+            pending->result = promise.get_future().share();
+            loading[path] = pending;
+            loader = true;
+        }
+        frameRate = targetFrameRate;
+        compression = compressionSettings;
+    }
+
+    if (!loader) {
+        const Loaded& loaded = pending->result.get();
+        if (!loaded.handle)
+            error = loaded.error;
+        return loaded.handle;
+    }
+
+    // Waiters block on the promise, so it has to be set even when the load throws
+    Loaded loaded;
+    try {
+        loaded = load(path, frameRate, compression);
+    }
+    catch (const std::exception& e) {
+        loaded.handle.reset();
+        loaded.error = e.what();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto inFlight = loading.find(path);
+        // Not kept when invalidated meanwhile, the file may have changed under the load
+        if (inFlight != loading.end() && inFlight->second == pending) {
+            loading.erase(inFlight);
+            if (loaded.handle) {
+                auto found = index.find(path);
+                if (found != index.end()) {
+                    entries.erase(found->second);
+                    index.erase(found);
+                }
+                entries.push_front({ path, loaded.handle, loaded.handle, loaded.handle->byteSize(), frameRate });
+                index[path] = entries.begin();
+                evictLocked();
+            }
+        }
+    }
+    promise.set_value(loaded);
+
+    if (!loaded.handle)
+        error = loaded.error;
+    return loaded.handle;
+}
+
+CacheRegistry::Loaded CacheRegistry::load(const std::string& path, double frameRate, const CompressionSettings& compression)
+{
+    Loaded loaded;
+
+    // Binary caches are mapped and used in place, legacy JSON caches are streamed
+    auto store = std::make_shared<FrameStore>();
+    const bool ok = SmearCacheFile::isCacheFile(path)
+        ? store->load(path, loaded.error)
+        : streamJsonCache(path, *store, loaded.error);
+    if (!ok)
+        return loaded;
+    // Once at load, so evaluation never has to convert between rates
+    if (frameRate > 0.0 && std::abs(store->fps() - frameRate) > 1e-6) {
+        auto resampled = std::make_shared<FrameStore>();
+        resampleFrames(*store, frameRate, *resampled);
+        store = std::move(resampled);
+    }
+    if (compression.enabled)
+        store->compress(compression);
+
+    loaded.handle = std::move(store);
+    return loaded;
+}
+
+void CacheRegistry::invalidate(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    loading.erase(path);
+    auto found = index.find(path);
+    if (found == index.end())
+        return;
+    entries.erase(found->second);
+    index.erase(found);
+}
+
+void CacheRegistry::releaseUnused()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.begin(); it != entries.end();) {
+        it->retained.reset();
+        if (it->live.expired()) {
+            index.erase(it->path);
+            it = entries.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void CacheRegistry::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    loading.clear();
+    entries.clear();
+    index.clear();
+}
+
+void CacheRegistry::setBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    memoryBudget = bytes;
+    evictLocked();
+}
+
+void CacheRegistry::setCompression(const CompressionSettings& settings)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    compressionSettings = settings;
+}
+
+CompressionSettings CacheRegistry::compression()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return compressionSettings;
+}
+
+void CacheRegistry::setFrameRate(double fps)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    targetFrameRate = std::max(fps, 0.0);
+}
+
+double CacheRegistry::frameRate()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return targetFrameRate;
+}
+
+size_t CacheRegistry::budget()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return memoryBudget;
+}
+
+size_t CacheRegistry::footprint()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return footprintLocked();
+}
+
+size_t CacheRegistry::cacheCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (const Entry& entry : entries)
+        if (!entry.live.expired())
+            ++count;
+    return count;
+}
+
+size_t CacheRegistry::hitCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+size_t CacheRegistry::missCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+void CacheRegistry::resetCounters()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    hits = 0;
+    misses = 0;
+}
+
+void CacheRegistry::evictLocked()
+{
+    size_t total = footprintLocked();
+
+    // Oldest first; caches a node still holds cannot be freed, so skip them
+    for (auto it = entries.rbegin(); it != entries.rend() && total > memoryBudget;) {
+        if (it->retained && it->retained.use_count() == 1) {
+            total -= it->bytes;
+            it->retained.reset();
+        }
+        ++it;
+    }
+
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->live.expired()) {
+            index.erase(it->path);
+            it = entries.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+size_t CacheRegistry::footprintLocked()
+{
+    size_t total = 0;
+    for (const Entry& entry : entries)
+        if (!entry.live.expired())
+            total += entry.bytes;
+    return total;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "frameStore.h"
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+Process-wide set of loaded vertex caches, keyed by file path.
+
+Nodes hold the shared_ptr they get from acquire() for as long as they sample
+it, so a cache stays loaded while anything in the scene uses it. On top of
+that the registry keeps recently used caches alive until their combined
+footprint exceeds the memory budget, then drops the least recently used ones
+nobody else holds. Switching between characters therefore does not reload
+their caches unless the budget forces it. Files are read without holding the
+registry's lock, so a slow load only blocks the callers waiting for that same
+path; they share the one load instead of starting their own. With compression on, caches are
+compressed as they are loaded and count against the budget at their
+compressed size.
+
+Caches are resampled to the frame rate set with setFrameRate() as they are
+loaded, so frame numbers of the scene index them directly. A cache loaded
+for another rate is read again on its next acquire().
+*/
+
+class CacheRegistry
+{
+public:
+    using Handle = std::shared_ptr<const FrameStore>;
+
+    // Loads a .smc or legacy .json cache, or returns the one already loaded from path
+    static Handle acquire(const std::string& path, std::string& error);
+    // Forgets the cache loaded from path so the next acquire() reads the file again.
+    // Nodes still holding the old data keep it until they rebind.
+    static void invalidate(const std::string& path);
+    // Drops every cache no node holds, regardless of the budget
+    static void releaseUnused();
+    static void clear();
+
+    static void setBudget(size_t bytes);
+    static size_t budget();
+    // Applies to caches loaded from now on
+    static void setCompression(const CompressionSettings& settings);
+    static CompressionSettings compression();
+    // Rate caches are resampled to, 0 keeps every cache at its own rate
+    static void setFrameRate(double fps);
+    static double frameRate();
+    // Footprint of every cache still alive, held by the registry or by a node
+    static size_t footprint();
+    static size_t cacheCount();
+    // acquire() calls served from memory vs. read from disk, since the last resetCounters()
+    static size_t hitCount();
+    static size_t missCount();
+    static void resetCounters();
+
+    static constexpr size_t kDefaultBudget = size_t(4) << 30;
+
+private:
+    struct Entry {
+        std::string path;
+        Handle retained;                    // LRU hold, reset on eviction
+        std::weak_ptr<const FrameStore> live;
+        size_t bytes;
+        double frameRate;                   // rate it was loaded for
+    };
+
+    struct Loaded {
+        Handle handle;
+        std::string error;
+    };
+    // A load in flight; invalidate() drops it from loading so its result is not kept
+    struct Load {
+        std::shared_future<Loaded> result;
+    };
+
+    static Loaded load(const std::string& path, double frameRate, const CompressionSettings& compression);
+    static void evictLocked();
+    static size_t footprintLocked();
+
+    static std::mutex mutex;
+    static std::list<Entry> entries;        // most recently used first
+    static std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    static std::unordered_map<std::string, std::shared_ptr<Load>> loading;
+    static size_t memoryBudget;
+    static CompressionSettings compressionSettings;
+    static double targetFrameRate;
+    static size_t hits;
+    static size_t misses;
+};
@@ -0,0 +1,230 @@
+#include "catmullRom.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <numeric>
+#include <vector>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define SMEAR_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SMEAR_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SMEAR_TARGET_AVX2
+#endif
+
+namespace {
+    void sampleScalar(const FrameStore& frames, const int* vertexIds, const int* baseFrames, const float* t,
+        int begin, int end, float* out)
+    {
+        for (int i = begin; i < end; ++i) {
+            float w[4];
+            catmullRomWeights(t[i], w);
+            const float* p0 = frames.position(frames.clampFrame(baseFrames[i] - 1), vertexIds[i]);
+            const float* p1 = frames.position(frames.clampFrame(baseFrames[i]), vertexIds[i]);
+            const float* p2 = frames.position(frames.clampFrame(baseFrames[i] + 1), vertexIds[i]);
+            const float* p3 = frames.position(frames.clampFrame(baseFrames[i] + 2), vertexIds[i]);
+            for (int c = 0; c < 3; ++c)
+                out[i * 3 + c] = p0[c] * w[0] + p1[c] * w[1] + p2[c] * w[2] + p3[c] * w[3];
+        }
+    }
+
+#ifdef SMEAR_X86
+    // xyz into the low three lanes without reading past the point
+    inline __m128 loadPoint(const float* p)
+    {
+        const __m128 xy = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p)));
+        return _mm_movelh_ps(xy, _mm_load_ss(p + 2));
+    }
+
+    void sampleSSE(const FrameStore& frames, const int* vertexIds, const int* baseFrames, const float* t,
+        int begin, int end, float* out)
+    {
+        alignas(16) float result[4];
+        for (int i = begin; i < end; ++i) {
+            float w[4];
+            catmullRomWeights(t[i], w);
+            const int v = vertexIds[i];
+            __m128 sum = _mm_mul_ps(loadPoint(frames.position(frames.clampFrame(baseFrames[i] - 1), v)), _mm_set1_ps(w[0]));
+            sum = _mm_add_ps(sum, _mm_mul_ps(loadPoint(frames.position(frames.clampFrame(baseFrames[i]), v)), _mm_set1_ps(w[1])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(loadPoint(frames.position(frames.clampFrame(baseFrames[i] + 1), v)), _mm_set1_ps(w[2])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(loadPoint(frames.position(frames.clampFrame(baseFrames[i] + 2), v)), _mm_set1_ps(w[3])));
+            _mm_store_ps(result, sum);
+            out[i * 3 + 0] = result[0];
+            out[i * 3 + 1] = result[1];
+            out[i * 3 + 2] = result[2];
+        }
+    }
+
+    // Element index of x for each control point: clamp(frame) * vertexCount * 3 + vertex * 3
+    SMEAR_TARGET_AVX2
+    inline __m256i gatherIndex(__m256i frame, __m256i lastFrame, __m256i frameStride, __m256i vertexOffset)
+    {
+        frame = _mm256_min_epi32(_mm256_max_epi32(frame, _mm256_setzero_si256()), lastFrame);
+        return _mm256_add_epi32(_mm256_mullo_epi32(frame, frameStride), vertexOffset);
+    }
+
+    SMEAR_TARGET_AVX2
+    inline __m256 blendComponent(const float* base, const __m256i index[4], const __m256 weight[4])
+    {
+        __m256 sum = _mm256_mul_ps(_mm256_i32gather_ps(base, index[0], 4), weight[0]);
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_i32gather_ps(base, index[1], 4), weight[1]));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_i32gather_ps(base, index[2], 4), weight[2]));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_i32gather_ps(base, index[3], 4), weight[3]));
+        return sum;
+    }
+
+    SMEAR_TARGET_AVX2
+    void sampleAVX2(const FrameStore& frames, const int* vertexIds, const int* baseFrames, const float* t,
+        int count, float* out)
+    {
+        const float* base = frames.positions(0);
+        const __m256i lastFrame = _mm256_set1_epi32(frames.frameCount() - 1);
+        const __m256i frameStride = _mm256_set1_epi32(frames.vertexCount() * 3);
+        const __m256i one = _mm256_set1_epi32(1);
+
+        alignas(32) float x[8], y[8], z[8];
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            // Basis weights for eight parameters at once
+            const __m256 tt = _mm256_loadu_ps(t + i);
+            const __m256 t2 = _mm256_mul_ps(tt, tt);
+            const __m256 t3 = _mm256_mul_ps(t2, tt);
+            const __m256 half = _mm256_set1_ps(0.5f);
+            __m256 w[4];
+            w[0] = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(-0.5f), t3), t2), _mm256_mul_ps(half, tt));
+            w[1] = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(1.5f), t3), _mm256_mul_ps(_mm256_set1_ps(2.5f), t2)), _mm256_set1_ps(1.0f));
+            w[2] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(-1.5f), t3), _mm256_mul_ps(_mm256_set1_ps(2.0f), t2)), _mm256_mul_ps(half, tt));
+            w[3] = _mm256_sub_ps(_mm256_mul_ps(half, t3), _mm256_mul_ps(half, t2));
+
+            const __m256i f1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(baseFrames + i));
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vertexIds + i));
+            const __m256i v3 = _mm256_add_epi32(_mm256_add_epi32(v, v), v);
+            __m256i index[4];
+            index[0] = gatherIndex(_mm256_sub_epi32(f1, one), lastFrame, frameStride, v3);
+            index[1] = gatherIndex(f1, lastFrame, frameStride, v3);
+            index[2] = gatherIndex(_mm256_add_epi32(f1, one), lastFrame, frameStride, v3);
+            index[3] = gatherIndex(_mm256_add_epi32(f1, _mm256_add_epi32(one, one)), lastFrame, frameStride, v3);
+
+            _mm256_store_ps(x, blendComponent(base + 0, index, w));
+            _mm256_store_ps(y, blendComponent(base + 1, index, w));
+            _mm256_store_ps(z, blendComponent(base + 2, index, w));
+
+            float* dst = out + static_cast<size_t>(i) * 3;
+            for (int k = 0; k < 8; ++k) {
+                dst[k * 3 + 0] = x[k];
+                dst[k * 3 + 1] = y[k];
+                dst[k * 3 + 2] = z[k];
+            }
+        }
+        sampleSSE(frames, vertexIds, baseFrames, t, i, count, out);
+    }
+
+    bool cpuHasAVX2()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+}
+
+CatmullRomPath bestCatmullRomPath()
+{
+#ifdef SMEAR_X86
+    static const CatmullRomPath path = cpuHasAVX2() ? CatmullRomPath::AVX2 : CatmullRomPath::SSE;
+    return path;
+#else
+    return CatmullRomPath::Scalar;
+#endif
+}
+
+void sampleTrajectories(const FrameStore& frames, const int* vertexIds, const int* baseFrames, const float* t,
+    int count, float* out)
+{
+    sampleTrajectories(bestCatmullRomPath(), frames, vertexIds, baseFrames, t, count, out);
+}
+
+void sampleTrajectories(CatmullRomPath path, const FrameStore& frames, const int* vertexIds, const int* baseFrames,
+    const float* t, int count, float* out)
+{
+    if (count <= 0 || frames.empty())
+        return;
+
+#ifdef SMEAR_X86
+    // Gathers use 32-bit element indices
+    const bool indexFits = static_cast<size_t>(frames.frameCount()) * frames.vertexCount() * 3 <= static_cast<size_t>(INT_MAX);
+    if (path == CatmullRomPath::AVX2 && indexFits) {
+        sampleAVX2(frames, vertexIds, baseFrames, t, count, out);
+        return;
+    }
+    if (path != CatmullRomPath::Scalar) {
+        sampleSSE(frames, vertexIds, baseFrames, t, 0, count, out);
+        return;
+    }
+#endif
+    sampleScalar(frames, vertexIds, baseFrames, t, 0, count, out);
+}
+
+void resampleFrames(const FrameStore& source, double fps, FrameStore& target)
+{
+    if (source.empty() || source.isCompressed() || fps <= 0.0) {
+        target.clear();
+        return;
+    }
+
+    // Frames of the new rate that fall within the source's time span; the epsilon keeps
+    // end frames that only miss it by rounding
+    const double kEpsilon = 1e-6;
+    const double ratio = fps / source.fps();
+    const int firstFrame = static_cast<int>(std::ceil(source.startFrame() * ratio - kEpsilon));
+    const int lastFrame = static_cast<int>(std::floor(source.endFrame() * ratio + kEpsilon));
+    const int frameCount = std::max(1, lastFrame - firstFrame + 1);
+    const int vertexCount = source.vertexCount();
+    target.allocate(firstFrame, frameCount, vertexCount, fps);
+
+    std::vector<int> vertexIds(vertexCount);
+    std::iota(vertexIds.begin(), vertexIds.end(), 0);
+    tbb::parallel_for(tbb::blocked_range<int>(0, frameCount), [&](const tbb::blocked_range<int>& range) {
+        std::vector<int> baseFrames(vertexCount);
+        std::vector<float> t(vertexCount);
+        for (int f = range.begin(); f != range.end(); ++f) {
+            const double x = std::clamp((firstFrame + f) / ratio - source.startFrame(), 0.0, source.frameCount() - 1.0);
+            const int base = static_cast<int>(std::floor(x));
+            std::fill(baseFrames.begin(), baseFrames.end(), base);
+            std::fill(t.begin(), t.end(), static_cast<float>(x - base));
+            sampleTrajectories(source, vertexIds.data(), baseFrames.data(), t.data(), vertexCount, target.mutablePositions(f));
+
+            float w[4];
+            catmullRomWeights(static_cast<float>(x - base), w);
+            const float* o0 = source.offsets(source.clampFrame(base - 1));
+            const float* o1 = source.offsets(source.clampFrame(base));
+            const float* o2 = source.offsets(source.clampFrame(base + 1));
+            const float* o3 = source.offsets(source.clampFrame(base + 2));
+            float* offsets = target.mutableOffsets(f);
+            for (int v = 0; v < vertexCount; ++v)
+                offsets[v] = std::clamp(o0[v] * w[0] + o1[v] * w[1] + o2[v] * w[2] + o3[v] * w[3], -1.0f, 1.0f);
+        }
+    });
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "frameStore.h"
+
+/*
+Batched Catmull-Rom sampling of baked vertex trajectories.
+
+For every i in [0, count):
+    out[i] = CatmullRom(P(baseFrames[i] - 1), P(baseFrames[i]), P(baseFrames[i] + 1), P(baseFrames[i] + 2), t[i])
+where P(f) is vertex vertexIds[i] at frame index f (clamped to the store) and
+out holds count xyz triples.
+
+The AVX2 path evaluates eight vertices per step with gathers straight out of
+the store, the SSE path evaluates xyz of one vertex per step; the best one the
+CPU supports is picked at first use. All paths compute in float.
+*/
+
+enum class CatmullRomPath {
+    Scalar,
+    SSE,
+    AVX2
+};
+
+void sampleTrajectories(const FrameStore& frames, const int* vertexIds, const int* baseFrames, const float* t,
+    int count, float* out);
+
+// Same as above with a fixed implementation, for benchmarking and testing
+void sampleTrajectories(CatmullRomPath path, const FrameStore& frames, const int* vertexIds, const int* baseFrames,
+    const float* t, int count, float* out);
+
+// Best implementation available on this CPU
+CatmullRomPath bestCatmullRomPath();
+
+// source at fps frames per second, spanning the same time: frame numbers become the ones at
+// the new rate, positions and offsets are Catmull-Rom interpolated between the source frames
+// and offsets are kept within [-1, 1]. source must not be compressed.
+void resampleFrames(const FrameStore& source, double fps, FrameStore& target);
+
+inline void catmullRomWeights(float t, float weights[4])
+{
+    // SMEAR paper uses standard Catmull-Rom interpolation (Section 4.1)
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    weights[0] = -0.5f * t3 + t2 - 0.5f * t;
+    weights[1] = 1.5f * t3 - 2.5f * t2 + 1.0f;
+    weights[2] = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
+    weights[3] = 0.5f * t3 - 0.5f * t2;
+}
@@ -0,0 +1,282 @@
+#include "compressedFrames.h"
+#include "frameStore.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SMEAR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    enum BlockWidth : uint8_t { kZero = 0, kByte = 1, kShort = 2 };
+
+    // q += d, wrapping, for one block of int8 differences
+    void addDeltas8(uint16_t* q, const uint8_t* d, int count)
+    {
+        int i = 0;
+#ifdef SMEAR_SSE2
+        for (; i + 16 <= count; i += 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(d + i));
+            const __m128i sign = _mm_cmpgt_epi8(_mm_setzero_si128(), bytes);
+            __m128i* out = reinterpret_cast<__m128i*>(q + i);
+            _mm_storeu_si128(out, _mm_add_epi16(_mm_loadu_si128(out), _mm_unpacklo_epi8(bytes, sign)));
+            _mm_storeu_si128(out + 1, _mm_add_epi16(_mm_loadu_si128(out + 1), _mm_unpackhi_epi8(bytes, sign)));
+        }
+#endif
+        for (; i < count; ++i)
+            q[i] = static_cast<uint16_t>(q[i] + static_cast<int8_t>(d[i]));
+    }
+
+    // q += d, wrapping, for one block of int16 differences (unaligned in the stream)
+    void addDeltas16(uint16_t* q, const uint8_t* d, int count)
+    {
+        int i = 0;
+#ifdef SMEAR_SSE2
+        for (; i + 8 <= count; i += 8) {
+            const __m128i delta = _mm_loadu_si128(reinterpret_cast<const __m128i*>(d + i * 2));
+            __m128i* out = reinterpret_cast<__m128i*>(q + i);
+            _mm_storeu_si128(out, _mm_add_epi16(_mm_loadu_si128(out), delta));
+        }
+#endif
+        for (; i < count; ++i) {
+            uint16_t delta;
+            std::memcpy(&delta, d + i * 2, sizeof(delta));
+            q[i] = static_cast<uint16_t>(q[i] + delta);
+        }
+    }
+
+    // out = origin + q * step over interleaved xyz
+    void dequantisePositions(const uint16_t* q, int count, const float origin[3], const float step[3], float* out)
+    {
+        int i = 0;
+#ifdef SMEAR_SSE2
+        // Twelve values are four points, so the xyz pattern lines up with three registers
+        const __m128 step0 = _mm_setr_ps(step[0], step[1], step[2], step[0]);
+        const __m128 step1 = _mm_setr_ps(step[1], step[2], step[0], step[1]);
+        const __m128 step2 = _mm_setr_ps(step[2], step[0], step[1], step[2]);
+        const __m128 origin0 = _mm_setr_ps(origin[0], origin[1], origin[2], origin[0]);
+        const __m128 origin1 = _mm_setr_ps(origin[1], origin[2], origin[0], origin[1]);
+        const __m128 origin2 = _mm_setr_ps(origin[2], origin[0], origin[1], origin[2]);
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 12 <= count; i += 12) {
+            const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(q + i));
+            const __m128i high = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(q + i + 8));
+            const __m128 v0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero));
+            const __m128 v1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero));
+            const __m128 v2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero));
+            _mm_storeu_ps(out + i, _mm_add_ps(origin0, _mm_mul_ps(v0, step0)));
+            _mm_storeu_ps(out + i + 4, _mm_add_ps(origin1, _mm_mul_ps(v1, step1)));
+            _mm_storeu_ps(out + i + 8, _mm_add_ps(origin2, _mm_mul_ps(v2, step2)));
+        }
+#endif
+        for (; i < count; ++i)
+            out[i] = origin[i % 3] + q[i] * step[i % 3];
+    }
+
+    void dequantiseOffsets8(const uint8_t* q, int count, float* out)
+    {
+        const float scale = 2.0f / 255.0f;
+        int i = 0;
+#ifdef SMEAR_SSE2
+        const __m128 scales = _mm_set1_ps(scale);
+        const __m128 minusOne = _mm_set1_ps(-1.0f);
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= count; i += 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(q + i));
+            const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+            const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+            const __m128i words[4] = {
+                _mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero),
+                _mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero)
+            };
+            for (int k = 0; k < 4; ++k)
+                _mm_storeu_ps(out + i + k * 4, _mm_add_ps(minusOne, _mm_mul_ps(_mm_cvtepi32_ps(words[k]), scales)));
+        }
+#endif
+        for (; i < count; ++i)
+            out[i] = q[i] * scale - 1.0f;
+    }
+
+    void dequantiseOffsets16(const uint8_t* q, int count, float* out)
+    {
+        const float scale = 2.0f / 65535.0f;
+        for (int i = 0; i < count; ++i) {
+            uint16_t value;
+            std::memcpy(&value, q + i * 2, sizeof(value));
+            out[i] = value * scale - 1.0f;
+        }
+    }
+}
+
+void CompressedFrames::encode(const FrameStore& frames, const CompressionSettings& settings)
+{
+    m_startFrame = frames.startFrame();
+    m_frameCount = frames.frameCount();
+    m_vertexCount = frames.vertexCount();
+    m_fps = frames.fps();
+    m_keyframeInterval = std::max(settings.keyframeInterval, 1);
+    m_offsetBits = settings.offsetBits > 8 ? 16 : 8;
+    m_positions.clear();
+    m_frameStarts.assign(1, 0);
+    m_offsets.clear();
+
+    const int valueCount = m_vertexCount * 3;
+    float lo[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float hi[3] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    for (int f = 0; f < m_frameCount; ++f) {
+        const float* p = frames.positions(f);
+        for (int i = 0; i < valueCount; ++i) {
+            lo[i % 3] = std::min(lo[i % 3], p[i]);
+            hi[i % 3] = std::max(hi[i % 3], p[i]);
+        }
+    }
+    for (int k = 0; k < 3; ++k) {
+        const double extent = m_frameCount > 0 ? static_cast<double>(hi[k]) - lo[k] : 0.0;
+        const double step = std::max(extent / 65535.0, 2.0 * settings.positionTolerance);
+        m_origin[k] = m_frameCount > 0 ? lo[k] : 0.0f;
+        m_step[k] = step > 0.0 ? static_cast<float>(step) : 1.0f;
+    }
+
+    std::vector<uint16_t> current(valueCount), previous(valueCount);
+    for (int f = 0; f < m_frameCount; ++f) {
+        const float* p = frames.positions(f);
+        for (int i = 0; i < valueCount; ++i) {
+            const double level = std::round((p[i] - m_origin[i % 3]) / m_step[i % 3]);
+            current[i] = static_cast<uint16_t>(std::clamp(level, 0.0, 65535.0));
+        }
+        appendPositions(current.data(), f % m_keyframeInterval == 0 ? nullptr : previous.data());
+        std::swap(current, previous);
+    }
+
+    const size_t offsetBytes = m_offsetBits / 8;
+    const double levels = m_offsetBits == 16 ? 65535.0 : 255.0;
+    m_offsets.resize(static_cast<size_t>(m_frameCount) * m_vertexCount * offsetBytes);
+    for (int f = 0; f < m_frameCount; ++f) {
+        const float* o = frames.offsets(f);
+        uint8_t* out = &m_offsets[static_cast<size_t>(f) * m_vertexCount * offsetBytes];
+        for (int v = 0; v < m_vertexCount; ++v) {
+            const double level = std::round((std::clamp(static_cast<double>(o[v]), -1.0, 1.0) + 1.0) * 0.5 * levels);
+            const uint16_t value = static_cast<uint16_t>(level);
+            if (offsetBytes == 1)
+                out[v] = static_cast<uint8_t>(value);
+            else
+                std::memcpy(out + v * 2, &value, sizeof(value));
+        }
+    }
+    m_positions.shrink_to_fit();
+}
+
+void CompressedFrames::appendPositions(const uint16_t* quantised, const uint16_t* previous)
+{
+    const int valueCount = m_vertexCount * 3;
+    if (!previous) {
+        const size_t start = m_positions.size();
+        m_positions.resize(start + static_cast<size_t>(valueCount) * 2);
+        std::memcpy(&m_positions[start], quantised, static_cast<size_t>(valueCount) * 2);
+        m_frameStarts.push_back(m_positions.size());
+        return;
+    }
+
+    // Block widths first, then the differences of the blocks that are not all zero
+    const int blockCount = (valueCount + kBlockSize - 1) / kBlockSize;
+    const size_t widths = m_positions.size();
+    m_positions.resize(widths + blockCount);
+    for (int b = 0; b < blockCount; ++b) {
+        const int begin = b * kBlockSize;
+        const int end = std::min(begin + kBlockSize, valueCount);
+        bool moved = false, fitsByte = true;
+        for (int i = begin; i < end; ++i) {
+            const int delta = static_cast<int16_t>(static_cast<uint16_t>(quantised[i] - previous[i]));
+            moved |= delta != 0;
+            fitsByte &= delta >= -128 && delta <= 127;
+        }
+        const BlockWidth width = !moved ? kZero : fitsByte ? kByte : kShort;
+        m_positions[widths + b] = width;
+        for (int i = begin; i < end && width != kZero; ++i) {
+            const uint16_t delta = static_cast<uint16_t>(quantised[i] - previous[i]);
+            if (width == kByte)
+                m_positions.push_back(static_cast<uint8_t>(delta));
+            else {
+                m_positions.push_back(static_cast<uint8_t>(delta & 0xff));
+                m_positions.push_back(static_cast<uint8_t>(delta >> 8));
+            }
+        }
+    }
+    m_frameStarts.push_back(m_positions.size());
+}
+
+void CompressedFrames::decode(int firstIdx, int lastIdx, FrameStore& window) const
+{
+    firstIdx = std::max(firstIdx, 0);
+    lastIdx = std::min(lastIdx, m_frameCount - 1);
+    if (firstIdx > lastIdx) {
+        window.clear();
+        return;
+    }
+    window.allocate(m_startFrame + firstIdx, lastIdx - firstIdx + 1, m_vertexCount, m_fps);
+    Cursor cursor;
+    decode(firstIdx, lastIdx, window, cursor);
+}
+
+void CompressedFrames::decode(int firstIdx, int lastIdx, FrameStore& window, Cursor& cursor) const
+{
+    firstIdx = std::max(firstIdx, 0);
+    lastIdx = std::min(lastIdx, m_frameCount - 1);
+    if (firstIdx > lastIdx)
+        return;
+
+    const int valueCount = m_vertexCount * 3;
+    const int blockCount = (valueCount + kBlockSize - 1) / kBlockSize;
+    std::vector<uint16_t>& quantised = cursor.quantised;
+    int f = firstIdx - firstIdx % m_keyframeInterval;
+    if (cursor.frameIdx >= f && cursor.frameIdx < firstIdx && quantised.size() == static_cast<size_t>(valueCount))
+        f = cursor.frameIdx + 1;
+    else
+        quantised.resize(valueCount);
+
+    for (; f <= lastIdx; ++f) {
+        const uint8_t* data = m_positions.data() + m_frameStarts[f];
+        if (f % m_keyframeInterval == 0)
+            std::memcpy(quantised.data(), data, static_cast<size_t>(valueCount) * 2);
+        else {
+            const uint8_t* payload = data + blockCount;
+            for (int b = 0; b < blockCount; ++b) {
+                const int begin = b * kBlockSize;
+                const int count = std::min(kBlockSize, valueCount - begin);
+                if (data[b] == kByte) {
+                    addDeltas8(&quantised[begin], payload, count);
+                    payload += count;
+                }
+                else if (data[b] == kShort) {
+                    addDeltas16(&quantised[begin], payload, count);
+                    payload += count * 2;
+                }
+            }
+        }
+        if (f < firstIdx)
+            continue;
+
+        const int windowIdx = window.frameIndex(m_startFrame + f);
+        dequantisePositions(quantised.data(), valueCount, m_origin, m_step, window.mutablePositions(windowIdx));
+        const size_t offsetBytes = m_offsetBits / 8;
+        const uint8_t* offsets = &m_offsets[static_cast<size_t>(f) * m_vertexCount * offsetBytes];
+        if (offsetBytes == 1)
+            dequantiseOffsets8(offsets, m_vertexCount, window.mutableOffsets(windowIdx));
+        else
+            dequantiseOffsets16(offsets, m_vertexCount, window.mutableOffsets(windowIdx));
+    }
+    cursor.frameIdx = lastIdx;
+}
+
+double CompressedFrames::maxPositionError() const
+{
+    return 0.5 * std::max({ m_step[0], m_step[1], m_step[2] });
+}
+
+size_t CompressedFrames::byteSize() const
+{
+    return m_positions.capacity() + m_frameStarts.capacity() * sizeof(size_t) + m_offsets.capacity();
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class FrameStore;
+
+struct CompressionSettings {
+    bool enabled = false;
+    // Largest position error allowed, in scene units; 0 uses the finest 16-bit grid
+    double positionTolerance = 0.0;
+    // 8 or 16; offsets are normalised to [-1, 1], so 8 bits is an error below 0.004
+    int offsetBits = 8;
+    // Frames between absolutely stored frames, the most a decode has to replay
+    int keyframeInterval = 8;
+};
+
+/*
+Quantised, delta-coded copy of a FrameStore.
+
+Positions are quantised to 16 bits per axis over the cache's bounding box, with
+a grid step of twice the tolerance (at most 65535 steps per axis). Every
+keyframeInterval-th frame stores the quantised values as they are, the frames
+between store the wrapped 16-bit difference to the previous frame in blocks of
+kBlockSize values. A block is 0, 1 or 2 bytes per value depending on its
+largest difference, so parts of the mesh that barely move cost next to nothing.
+Offsets are quantised to offsetBits per frame without delta coding.
+
+Decoding is exact with respect to the quantised values and runs with SSE2 on
+x86. Frames are only readable decoded, through decode() into an owned store.
+*/
+
+class CompressedFrames
+{
+public:
+    static const int kBlockSize = 64;
+
+    // Where a decode stopped: the quantised positions of frameIdx, so decoding the frames right
+    // after it continues from there instead of replaying from their keyframe
+    struct Cursor {
+        int frameIdx = -1;
+        std::vector<uint16_t> quantised;
+    };
+
+    void encode(const FrameStore& frames, const CompressionSettings& settings);
+    // Allocates window as frames [firstIdx, lastIdx] of the original store, its startFrame
+    // shifted to match, so window.frameIndex(frame) still finds a given frame
+    void decode(int firstIdx, int lastIdx, FrameStore& window) const;
+    // Rewrites frames [firstIdx, lastIdx] of window, an owned store already holding them numbered
+    // like the original; cursor is left on lastIdx
+    void decode(int firstIdx, int lastIdx, FrameStore& window, Cursor& cursor) const;
+
+    int startFrame() const { return m_startFrame; }
+    int frameCount() const { return m_frameCount; }
+    int vertexCount() const { return m_vertexCount; }
+    double fps() const { return m_fps; }
+    // Largest difference between a decoded and an original position
+    double maxPositionError() const;
+    size_t byteSize() const;
+
+private:
+    void appendPositions(const uint16_t* quantised, const uint16_t* previous);
+
+    int m_startFrame = 0;
+    int m_frameCount = 0;
+    int m_vertexCount = 0;
+    double m_fps = 24.0;
+    int m_keyframeInterval = 8;
+    int m_offsetBits = 8;
+
+    float m_origin[3] = { 0.0f, 0.0f, 0.0f };
+    float m_step[3] = { 1.0f, 1.0f, 1.0f };
+
+    // Frame f's positions are m_positions[m_frameStarts[f], m_frameStarts[f + 1])
+    std::vector<uint8_t> m_positions;
+    std::vector<size_t> m_frameStarts;
+    std::vector<uint8_t> m_offsets;
+};
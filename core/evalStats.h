@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/*
+Where a node's evaluation time goes.
+
+Stage times are milliseconds spent in that stage during the last evaluation,
+except bakeMs which is how long the last (re-)bake took, whenever that was.
+A cache hit is an evaluation served from already baked and smoothed data; a
+miss had to bake or re-smooth first. Counters accumulate until reset().
+*/
+struct EvalStats {
+    double bakeMs = 0.0;
+    double smoothMs = 0.0;
+    double interpolateMs = 0.0;
+    double meshMs = 0.0;            // building the output mesh (copy, MFnMesh::create)
+    double evaluateMs = 0.0;        // the whole deform/compute, stages included
+    int64_t evaluations = 0;
+    int64_t verticesProcessed = 0;  // written to the output in the last evaluation
+    int64_t cacheHits = 0;
+    int64_t cacheMisses = 0;
+    size_t residentBytes = 0;       // baked positions, offsets and smoothed offsets the node holds
+
+    void countLookup(bool hit) { ++(hit ? cacheHits : cacheMisses); }
+    void reset() { *this = EvalStats(); }
+};
+
+// Stores the milliseconds between construction and destruction in target
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(double& target) : m_target(target), m_start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer()
+    {
+        m_target = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    double& m_target;
+    std::chrono::steady_clock::time_point m_start;
+};
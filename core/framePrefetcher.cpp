@@ -0,0 +1,85 @@
+#include "framePrefetcher.h"
+#include <algorithm>
+#include <cstdlib>
+
+FramePrefetcher::~FramePrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_one();
+    if (m_worker.joinable())
+        m_worker.join();
+}
+
+void FramePrefetcher::request(const std::shared_ptr<const FrameStore>& store, int frameIdx, int reach)
+{
+    if (!store || !store->isMapped())
+        return;
+
+    int step = m_tracking ? frameIdx - m_lastFrame : 0;
+    if (std::abs(step) > kMaxStep)
+        step = 0;
+    m_lastFrame = frameIdx;
+    m_tracking = true;
+
+    const int ahead = frameIdx + step * kLookahead;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_store = store;
+        m_first = std::min(frameIdx, ahead) - reach;
+        m_last = std::max(frameIdx, ahead) + reach;
+        m_direction = step < 0 ? -1 : 1;
+        m_pending = true;
+        if (!m_worker.joinable())
+            m_worker = std::thread(&FramePrefetcher::run, this);
+    }
+    m_wake.notify_one();
+}
+
+void FramePrefetcher::run()
+{
+    std::weak_ptr<const FrameStore> warmStore;
+    int warmFirst = 0, warmLast = -1;
+
+    for (;;) {
+        std::shared_ptr<const FrameStore> store;
+        int first, last, direction;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_quit || m_pending; });
+            if (m_quit)
+                return;
+            store = std::move(m_store);
+            first = m_first;
+            last = m_last;
+            direction = m_direction;
+            m_pending = false;
+        }
+
+        if (warmStore.lock() != store) {
+            warmStore = store;
+            warmFirst = 0;
+            warmLast = -1;
+        }
+
+        // Frames playback reaches first are paged in first
+        bool interrupted = false;
+        for (int i = 0; i <= last - first && !interrupted; ++i) {
+            const int frameIdx = direction > 0 ? first + i : last - i;
+            if (frameIdx >= warmFirst && frameIdx <= warmLast)
+                continue;
+            store->prefetch(frameIdx, frameIdx);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_quit)
+                return;
+            interrupted = m_pending;
+        }
+        if (!interrupted) {
+            warmFirst = first;
+            warmLast = last;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "frameStore.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/*
+Pages the frames playback is about to sample into memory ahead of evaluation.
+
+Evaluations call request() with the frame they sample and how many frames
+either side of it they read. Consecutive requests give the playback direction
+and step; a worker thread then pages in every frame the next kLookahead
+evaluations will read, nearest first, so mapped caches larger than RAM play
+without the evaluation stalling on page faults. A newer request interrupts the
+one in progress, and frames already paged in for the same store are skipped.
+
+Owned stores are resident anyway and never start the worker, nor do compressed
+ones: their FrameWindow only decodes the frame playback brings into the window,
+continuing from the one before it.
+*/
+
+class FramePrefetcher
+{
+public:
+    static const int kLookahead = 8;
+    // A larger step is a jump, not playback, and only the frames around it are paged in
+    static const int kMaxStep = 8;
+
+    FramePrefetcher() = default;
+    ~FramePrefetcher();
+    FramePrefetcher(const FramePrefetcher&) = delete;
+    FramePrefetcher& operator=(const FramePrefetcher&) = delete;
+
+    void request(const std::shared_ptr<const FrameStore>& store, int frameIdx, int reach);
+    // Forgets the playback direction, e.g. when playback stops
+    void reset() { m_tracking = false; }
+
+private:
+    void run();
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::thread m_worker;
+    bool m_quit = false;
+
+    // Latest window, handed to the worker under m_mutex
+    std::shared_ptr<const FrameStore> m_store;
+    int m_first = 0;
+    int m_last = -1;
+    int m_direction = 1;
+    bool m_pending = false;
+
+    // Playback tracking, only touched by the evaluating thread
+    int m_lastFrame = 0;
+    bool m_tracking = false;
+};
@@ -0,0 +1,228 @@
+#include "frameStore.h"
+#include <cstdlib>
+#include <cstring>
+
+FrameStore::FrameStore() :
+    m_startFrame(0), m_frameCount(0), m_vertexCount(0), m_fps(24.0),
+    m_positions(nullptr), m_offsets(nullptr), m_ownedFirst(0)
+{}
+
+FrameStore::~FrameStore()
+{}
+
+void FrameStore::allocate(int startFrame, int frameCount, int vertexCount, double fps)
+{
+    clear();
+    m_startFrame = startFrame;
+    m_frameCount = frameCount;
+    m_vertexCount = vertexCount;
+    m_fps = fps;
+
+    const size_t count = static_cast<size_t>(frameCount) * vertexCount;
+    m_ownedPositions.assign(count * 3, 0.0f);
+    m_ownedOffsets.assign(count, 0.0f);
+    m_positions = m_ownedPositions.data();
+    m_offsets = m_ownedOffsets.data();
+}
+
+bool FrameStore::load(const std::string& path, std::string& error)
+{
+    clear();
+
+    auto mapping = std::make_unique<SmearCacheFile>();
+    if (!mapping->open(path, error))
+        return false;
+
+    const int frameCount = mapping->frameCount();
+    const int vertexCount = mapping->vertexCount();
+    const SmearCacheHeader& header = mapping->header();
+
+    if (mapping->positionScalar() == SmearCacheScalar::Float32 &&
+        mapping->offsetScalar() == SmearCacheScalar::Float32) {
+        m_startFrame = header.startFrame;
+        m_frameCount = frameCount;
+        m_vertexCount = vertexCount;
+        m_fps = header.fps;
+        m_positions = static_cast<const float*>(mapping->positionData(0));
+        m_offsets = static_cast<const float*>(mapping->offsetData(0));
+        m_mapping = std::move(mapping);
+        return true;
+    }
+
+    // Double precision caches cannot be viewed as float, narrow them once
+    allocate(header.startFrame, frameCount, vertexCount, header.fps);
+    const size_t count = static_cast<size_t>(frameCount) * vertexCount;
+    if (mapping->positionScalar() == SmearCacheScalar::Float64) {
+        const double* src = static_cast<const double*>(mapping->positionData(0));
+        std::copy(src, src + count * 3, m_ownedPositions.begin());
+    }
+    else {
+        const float* src = static_cast<const float*>(mapping->positionData(0));
+        std::copy(src, src + count * 3, m_ownedPositions.begin());
+    }
+    if (mapping->offsetScalar() == SmearCacheScalar::Float64) {
+        const double* src = static_cast<const double*>(mapping->offsetData(0));
+        std::copy(src, src + count, m_ownedOffsets.begin());
+    }
+    else {
+        const float* src = static_cast<const float*>(mapping->offsetData(0));
+        std::copy(src, src + count, m_ownedOffsets.begin());
+    }
+    return true;
+}
+
+bool FrameStore::write(const std::string& path, std::string& error) const
+{
+    if (empty()) {
+        error = "frame store is empty";
+        return false;
+    }
+    if (m_compressed) {
+        error = "frame store is compressed";
+        return false;
+    }
+    return writeSmearCache(path, m_vertexCount, m_startFrame, endFrame(), m_fps, m_positions, m_offsets, error);
+}
+
+void FrameStore::clear()
+{
+    m_mapping.reset();
+    m_compressed.reset();
+    m_ownedPositions = std::vector<float>();
+    m_ownedOffsets = std::vector<float>();
+    m_ownedFirst = 0;
+    m_positions = nullptr;
+    m_offsets = nullptr;
+    m_startFrame = 0;
+    m_frameCount = 0;
+    m_vertexCount = 0;
+    m_fps = 24.0;
+}
+
+void FrameStore::prefetch(int firstIdx, int lastIdx) const
+{
+    firstIdx = std::max(firstIdx, 0);
+    lastIdx = std::min(lastIdx, m_frameCount - 1);
+    if (!m_mapping || firstIdx > lastIdx)
+        return;
+
+    // Frame-major, so a range of frames is one span in each block
+    const size_t frames = static_cast<size_t>(lastIdx - firstIdx + 1);
+    m_mapping->prefetch(positions(firstIdx), frames * m_vertexCount * 3 * sizeof(float));
+    m_mapping->prefetch(offsets(firstIdx), frames * m_vertexCount * sizeof(float));
+}
+
+void FrameStore::compress(const CompressionSettings& settings)
+{
+    if (m_compressed || empty())
+        return;
+
+    auto compressed = std::make_unique<CompressedFrames>();
+    compressed->encode(*this, settings);
+    const int startFrame = m_startFrame, frameCount = m_frameCount, vertexCount = m_vertexCount;
+    const double fps = m_fps;
+    clear();
+    m_startFrame = startFrame;
+    m_frameCount = frameCount;
+    m_vertexCount = vertexCount;
+    m_fps = fps;
+    m_compressed = std::move(compressed);
+}
+
+void FrameStore::decodeWindow(int firstIdx, int lastIdx, FrameStore& window) const
+{
+    if (m_compressed)
+        m_compressed->decode(firstIdx, lastIdx, window);
+    else
+        window.clear();
+}
+
+void FrameStore::decodeWindow(int firstIdx, int lastIdx, FrameStore& window, CompressedFrames::Cursor& cursor) const
+{
+    if (m_compressed)
+        m_compressed->decode(firstIdx, lastIdx, window, cursor);
+}
+
+void FrameStore::slide(int startFrame)
+{
+    const int shift = startFrame - m_startFrame;
+    m_startFrame = startFrame;
+    if (shift == 0 || empty())
+        return;
+
+    const size_t frameValues = static_cast<size_t>(m_vertexCount);
+    const size_t capacity = std::max(m_ownedOffsets.size() / frameValues, static_cast<size_t>(m_frameCount) * 2);
+    m_ownedPositions.resize(capacity * frameValues * 3);
+    m_ownedOffsets.resize(capacity * frameValues);
+
+    const long long first = static_cast<long long>(m_ownedFirst) + shift;
+    if (first >= 0 && first + m_frameCount <= static_cast<long long>(capacity)) {
+        m_ownedFirst = static_cast<size_t>(first);
+    }
+    else {
+        // Out of room: the shared frames move to the end of the buffers the store is moving away from
+        const size_t target = shift > 0 ? 0 : capacity - m_frameCount;
+        const int kept = m_frameCount - std::abs(shift);
+        if (kept > 0) {
+            // Frame-major, so the shared frames are one span in each buffer
+            const size_t from = (m_ownedFirst + (shift > 0 ? shift : 0)) * frameValues;
+            const size_t to = (target + (shift > 0 ? 0 : -shift)) * frameValues;
+            const size_t values = static_cast<size_t>(kept) * frameValues;
+            std::memmove(m_ownedPositions.data() + to * 3, m_ownedPositions.data() + from * 3, values * 3 * sizeof(float));
+            std::memmove(m_ownedOffsets.data() + to, m_ownedOffsets.data() + from, values * sizeof(float));
+        }
+        m_ownedFirst = target;
+    }
+    m_positions = m_ownedPositions.data() + m_ownedFirst * frameValues * 3;
+    m_offsets = m_ownedOffsets.data() + m_ownedFirst * frameValues;
+}
+
+size_t FrameStore::byteSize() const
+{
+    if (m_compressed)
+        return m_compressed->byteSize();
+    return static_cast<size_t>(m_frameCount) * m_vertexCount * 4 * sizeof(float);
+}
+
+size_t FrameStore::residentBytes() const
+{
+    const size_t compressed = m_compressed ? m_compressed->byteSize() : 0;
+    return (m_ownedPositions.capacity() + m_ownedOffsets.capacity()) * sizeof(float) + compressed;
+}
+
+const FrameStore& FrameWindow::view(const std::shared_ptr<const FrameStore>& store, int firstIdx, int lastIdx, bool* decoded)
+{
+    if (decoded)
+        *decoded = false;
+    if (!store->isCompressed()) {
+        m_source.reset();
+        m_frames.clear();
+        return *store;
+    }
+
+    firstIdx = std::max(firstIdx, 0);
+    lastIdx = std::min(lastIdx, store->frameCount() - 1);
+    const bool sameSource = m_source.lock() == store;
+    if (sameSource && firstIdx == m_first && lastIdx == m_last)
+        return m_frames;
+
+    // A range of the same length overlapping the last one keeps the frames they share
+    const int shared = std::min(lastIdx, m_last) - std::max(firstIdx, m_first) + 1;
+    if (sameSource && lastIdx - firstIdx == m_last - m_first && shared > 0) {
+        m_frames.slide(store->startFrame() + firstIdx);
+        if (firstIdx > m_first)
+            store->decodeWindow(m_last + 1, lastIdx, m_frames, m_cursor);
+        else
+            store->decodeWindow(firstIdx, m_first - 1, m_frames, m_cursor);
+    }
+    else {
+        store->decodeWindow(firstIdx, lastIdx, m_frames);
+        m_cursor.frameIdx = -1;
+    }
+    m_source = store;
+    m_first = firstIdx;
+    m_last = lastIdx;
+    if (decoded)
+        *decoded = true;
+    return m_frames;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "smearCache.h"
+#include "compressedFrames.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+Dense store of baked per-vertex data, indexed by (frame - startFrame).
+
+    positions   frameCount * vertexCount * 3 floats, frame-major, xyz interleaved
+    offsets     frameCount * vertexCount floats, frame-major
+
+The buffers are either owned by the store or a float32 SmearCacheFile mapped
+in place, readers cannot tell the difference. A compressed store keeps only a
+CompressedFrames copy: positions() and offsets() are not available on it, it
+is read through decodeWindow() or a FrameWindow.
+*/
+
+class FrameStore
+{
+public:
+    FrameStore();
+    ~FrameStore();
+    FrameStore(FrameStore&&) = default;
+    FrameStore& operator=(FrameStore&&) = default;
+    FrameStore(const FrameStore&) = delete;
+    FrameStore& operator=(const FrameStore&) = delete;
+
+    // Owned, zero-filled buffers ready to be written through mutablePositions/mutableOffsets
+    void allocate(int startFrame, int frameCount, int vertexCount, double fps = 24.0);
+    // Binary cache; float32 files are used in place, float64 files are converted
+    bool load(const std::string& path, std::string& error);
+    bool write(const std::string& path, std::string& error) const;
+    void clear();
+    void setFps(double fps) { m_fps = fps; }
+
+    bool empty() const { return m_frameCount == 0; }
+    int startFrame() const { return m_startFrame; }
+    int endFrame() const { return m_startFrame + m_frameCount - 1; }
+    int frameCount() const { return m_frameCount; }
+    int vertexCount() const { return m_vertexCount; }
+    double fps() const { return m_fps; }
+    bool isMapped() const { return m_mapping != nullptr; }
+    bool isCompressed() const { return m_compressed != nullptr; }
+    // Heap memory held by the store; mapped pages belong to the OS page cache
+    size_t residentBytes() const;
+    // Size of the data whether owned, mapped or compressed
+    size_t byteSize() const;
+    // Pages frames [firstIdx, lastIdx] of a mapped store into memory, blocking; owned and
+    // compressed stores are already resident and return at once
+    void prefetch(int firstIdx, int lastIdx) const;
+
+    // Replaces the frames with a quantised copy, dropping the owned buffers or the mapping
+    void compress(const CompressionSettings& settings);
+    // Frames [firstIdx, lastIdx] as an owned store numbered like this one; only for compressed stores
+    void decodeWindow(int firstIdx, int lastIdx, FrameStore& window) const;
+    // Rewrites frames [firstIdx, lastIdx] of window, an owned store already holding them, continuing from cursor
+    void decodeWindow(int firstIdx, int lastIdx, FrameStore& window, CompressedFrames::Cursor& cursor) const;
+    double maxPositionError() const { return m_compressed ? m_compressed->maxPositionError() : 0.0; }
+
+    int frameIndex(int frame) const { return frame - m_startFrame; }
+    bool hasFrame(int frameIdx) const { return frameIdx >= 0 && frameIdx < m_frameCount; }
+    int clampFrame(int frameIdx) const { return std::clamp(frameIdx, 0, m_frameCount - 1); }
+
+    const float* positions(int frameIdx) const { return m_positions + static_cast<size_t>(frameIdx) * m_vertexCount * 3; }
+    const float* offsets(int frameIdx) const { return m_offsets + static_cast<size_t>(frameIdx) * m_vertexCount; }
+    const float* position(int frameIdx, int vertexId) const { return positions(frameIdx) + static_cast<size_t>(vertexId) * 3; }
+    float offset(int frameIdx, int vertexId) const { return offsets(frameIdx)[vertexId]; }
+
+    // Only valid on stores created with allocate()
+    float* mutablePositions(int frameIdx) { return m_ownedPositions.data() + (m_ownedFirst + frameIdx) * m_vertexCount * 3; }
+    float* mutableOffsets(int frameIdx) { return m_ownedOffsets.data() + (m_ownedFirst + frameIdx) * m_vertexCount; }
+    // Renumbers an owned store to start at startFrame, keeping the frames both numberings share;
+    // the others hold stale values until they are rewritten. The buffers grow to twice the
+    // frames on the first slide, so most slides only move where the store starts in them
+    void slide(int startFrame);
+
+private:
+    int m_startFrame;
+    int m_frameCount;
+    int m_vertexCount;
+    double m_fps;
+
+    const float* m_positions;
+    const float* m_offsets;
+
+    std::vector<float> m_ownedPositions;
+    std::vector<float> m_ownedOffsets;
+    // Owned frame m_positions starts at, moved by slide()
+    size_t m_ownedFirst;
+    std::unique_ptr<SmearCacheFile> m_mapping;
+    std::unique_ptr<CompressedFrames> m_compressed;
+};
+
+// The frames a node samples: the store itself, or for a compressed store the frames
+// around what it samples. When the range moves, as it does every frame of playback, only
+// the frames entering it are decoded, continuing from the last decoded frame when they
+// follow it. Frames are numbered like the store's, so look indices up with frameIndex()
+// on the returned store.
+class FrameWindow
+{
+public:
+    // decoded is set when the returned frames changed since the last call
+    const FrameStore& view(const std::shared_ptr<const FrameStore>& store, int firstIdx, int lastIdx, bool* decoded = nullptr);
+
+private:
+    // Held weakly, so a store freed and reloaded at the same address is still a different store
+    std::weak_ptr<const FrameStore> m_source;
+    int m_first = 0;
+    int m_last = -1;
+    FrameStore m_frames;
+    CompressedFrames::Cursor m_cursor;
+};
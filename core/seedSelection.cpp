@@ -0,0 +1,89 @@
+#include "seedSelection.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+namespace {
+    // Still vertices can still seed a line, just rarely
+    const float kMinSeedWeight = 0.05f;
+
+    uint32_t hashId(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    struct Candidate {
+        double key;
+        int vertex;
+    };
+}
+
+std::vector<int> selectMotionLineSeeds(const FrameStore& frames, int count, uint32_t salt)
+{
+    const int vertexCount = frames.vertexCount();
+    count = std::min(count, vertexCount);
+    if (count <= 0 || frames.empty())
+        return {};
+
+    std::vector<float> peak(vertexCount, 0.0f);
+    for (int f = 0; f < frames.frameCount(); ++f) {
+        const float* offsets = frames.offsets(f);
+        for (int v = 0; v < vertexCount; ++v)
+            peak[v] = std::max(peak[v], std::abs(offsets[v]));
+    }
+
+    // log(u) / w orders the same as u^(1/w) without underflowing for small weights
+    const uint32_t saltHash = hashId(salt);
+    std::vector<Candidate> candidates(vertexCount);
+    for (int v = 0; v < vertexCount; ++v) {
+        const double u = (hashId(static_cast<uint32_t>(v) ^ saltHash) + 0.5) / 4294967296.0;
+        candidates[v] = { std::log(u) / (kMinSeedWeight + peak[v]), v };
+    }
+
+    const auto better = [](const Candidate& a, const Candidate& b) {
+        return a.key > b.key || (a.key == b.key && a.vertex < b.vertex);
+    };
+    const int candidateCount = static_cast<int>(std::min<int64_t>(vertexCount, static_cast<int64_t>(count) * kSeedCandidates));
+    std::nth_element(candidates.begin(), candidates.begin() + (candidateCount - 1), candidates.end(), better);
+    candidates.resize(candidateCount);
+    std::sort(candidates.begin(), candidates.end(), better);
+
+    // A grid of about sqrt(count) cells along the longest side has about count cells on a surface
+    float lo[3] = { INFINITY, INFINITY, INFINITY };
+    float hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (const Candidate& c : candidates) {
+        const float* p = frames.position(0, c.vertex);
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = std::min(lo[k], p[k]);
+            hi[k] = std::max(hi[k], p[k]);
+        }
+    }
+    const float extent = std::max({ hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] });
+    const float divisions = std::ceil(std::sqrt(static_cast<float>(count)));
+    const float cellSize = extent > 0.0f ? extent / divisions : 1.0f;
+
+    std::vector<int> seeds;
+    seeds.reserve(count);
+    std::vector<char> taken(candidateCount, 0);
+    std::unordered_set<int64_t> occupied;
+    for (int i = 0; i < candidateCount && static_cast<int>(seeds.size()) < count; ++i) {
+        const float* p = frames.position(0, candidates[i].vertex);
+        int64_t cell = 0;
+        for (int k = 0; k < 3; ++k)
+            cell = (cell << 21) | static_cast<int64_t>(std::floor((p[k] - lo[k]) / cellSize));
+        if (occupied.insert(cell).second) {
+            seeds.push_back(candidates[i].vertex);
+            taken[i] = 1;
+        }
+    }
+    for (int i = 0; i < candidateCount && static_cast<int>(seeds.size()) < count; ++i) {
+        if (!taken[i])
+            seeds.push_back(candidates[i].vertex);
+    }
+    return seeds;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "frameStore.h"
+#include <cstdint>
+#include <vector>
+
+/*
+Seed vertices for motion lines.
+
+Each vertex draws a key from a hash of its id, weighted by its peak |offset|
+over the clip (Efraimidis-Spirakis weighted reservoir sampling: key = u^(1/w)).
+Vertices that lead or trail the motion are favoured over the still middle,
+and since keys do not depend on the frame or on the order vertices are
+visited, the same seeds come back after any edit that keeps vertex ids.
+
+Only the best count * kSeedCandidates keys are sorted. They are taken in key
+order with at most one seed per cell of a voxel grid over their first-frame
+positions, spreading lines over the surface; once every occupied cell has a
+seed, the remaining best keys fill up to count.
+*/
+
+const int kSeedCandidates = 8;
+
+// At most count distinct vertex ids, best first; empty when the store is
+std::vector<int> selectMotionLineSeeds(const FrameStore& frames, int count, uint32_t salt = 12345);
@@ -0,0 +1,264 @@
+#include "smearCache.h"
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    uint64_t alignUp(uint64_t value)
+    {
+        const uint64_t a = SmearCacheFormat::kBlockAlignment;
+        return (value + a - 1) / a * a;
+    }
+
+    bool isValidScalar(uint32_t scalar)
+    {
+        return scalar == static_cast<uint32_t>(SmearCacheScalar::Float32)
+            || scalar == static_cast<uint32_t>(SmearCacheScalar::Float64);
+    }
+
+    // [offset, offset + bytes) lies inside a file of size bytes
+    bool blockFits(uint64_t offset, uint64_t bytes, uint64_t size)
+    {
+        return offset <= size && bytes <= size - offset;
+    }
+
+    // Both blocks start after the header and neither runs into the other; only for blocks that
+    // passed blockFits, so the ends cannot overflow
+    bool blocksDisjoint(uint64_t firstOffset, uint64_t firstBytes, uint64_t secondOffset, uint64_t secondBytes)
+    {
+        return firstOffset >= sizeof(SmearCacheHeader) && secondOffset >= sizeof(SmearCacheHeader) &&
+            (firstOffset + firstBytes <= secondOffset || secondOffset + secondBytes <= firstOffset);
+    }
+
+    template <typename T>
+    bool writeCache(const std::string& path, int vertexCount, int startFrame, int endFrame, double fps,
+        const T* positions, const T* offsets, std::string& error)
+    {
+        if (vertexCount <= 0 || endFrame < startFrame) {
+            error = "invalid vertex count or frame range";
+            return false;
+        }
+
+        const uint64_t frameCount = static_cast<uint64_t>(endFrame - startFrame + 1);
+        const uint64_t positionBytes = frameCount * vertexCount * 3 * sizeof(T);
+        const uint64_t offsetBytes = frameCount * vertexCount * sizeof(T);
+
+        SmearCacheHeader header = {};
+        std::memcpy(header.magic, SmearCacheFormat::kMagic, sizeof(header.magic));
+        header.version = SmearCacheFormat::kVersion;
+        header.vertexCount = static_cast<uint32_t>(vertexCount);
+        header.startFrame = startFrame;
+        header.endFrame = endFrame;
+        header.positionScalar = sizeof(T);
+        header.offsetScalar = sizeof(T);
+        header.fps = fps;
+        header.positionsOffset = alignUp(sizeof(SmearCacheHeader));
+        header.offsetsOffset = alignUp(header.positionsOffset + positionBytes);
+        header.fileSize = header.offsetsOffset + offsetBytes;
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            error = "could not open " + path + " for writing";
+            return false;
+        }
+
+        const char padding[SmearCacheFormat::kBlockAlignment] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(padding, header.positionsOffset - sizeof(header));
+        file.write(reinterpret_cast<const char*>(positions), positionBytes);
+        file.write(padding, header.offsetsOffset - (header.positionsOffset + positionBytes));
+        file.write(reinterpret_cast<const char*>(offsets), offsetBytes);
+
+        if (!file) {
+            error = "failed while writing " + path;
+            return false;
+        }
+        return true;
+    }
+}
+
+SmearCacheFile::SmearCacheFile() :
+    data(nullptr), size(0),
+#ifdef _WIN32
+    fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+#else
+    fileDescriptor(-1)
+#endif
+{}
+
+SmearCacheFile::~SmearCacheFile()
+{
+    close();
+}
+
+bool SmearCacheFile::open(const std::string& path, std::string& error)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "could not open " + path;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(SmearCacheHeader)) {
+        CloseHandle(file);
+        error = path + " is too small to be a cache file";
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        error = "could not map " + path;
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "could not open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SmearCacheHeader)) {
+        ::close(fd);
+        error = path + " is too small to be a cache file";
+        return false;
+    }
+    void* view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        error = "could not map " + path;
+        return false;
+    }
+    fileDescriptor = fd;
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(st.st_size);
+#endif
+
+    // Validate the header before anything reads through it
+    const SmearCacheHeader& h = header();
+    const char* problem = nullptr;
+    if (std::memcmp(h.magic, SmearCacheFormat::kMagic, sizeof(h.magic)) != 0)
+        problem = "not a SMEARin cache file";
+    else if (h.version != SmearCacheFormat::kVersion)
+        problem = "unsupported cache version";
+    else if (h.vertexCount == 0 || h.endFrame < h.startFrame)
+        problem = "empty cache";
+    else if (!isValidScalar(h.positionScalar) || !isValidScalar(h.offsetScalar))
+        problem = "unknown scalar type";
+    else {
+        // In 64 bits: a corrupt header can hold any frame range and vertex count
+        const int64_t frames = static_cast<int64_t>(h.endFrame) - h.startFrame + 1;
+        const uint64_t values = static_cast<uint64_t>(frames) * h.vertexCount;
+        if (frames > INT_MAX || h.vertexCount > INT_MAX)
+            problem = "cache too large";
+        else if (values > size)
+            problem = "truncated cache file";
+        else if (h.positionsOffset % SmearCacheFormat::kBlockAlignment != 0 ||
+            h.offsetsOffset % SmearCacheFormat::kBlockAlignment != 0 ||
+            !blockFits(h.positionsOffset, values * 3 * h.positionScalar, size) ||
+            !blockFits(h.offsetsOffset, values * h.offsetScalar, size))
+            problem = "truncated cache file";
+        else if (!blocksDisjoint(h.positionsOffset, values * 3 * h.positionScalar, h.offsetsOffset, values * h.offsetScalar))
+            problem = "overlapping cache blocks";
+    }
+
+    if (problem) {
+        error = path + ": " + problem;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SmearCacheFile::close()
+{
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+    if (fileDescriptor >= 0) ::close(fileDescriptor);
+    fileDescriptor = -1;
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+const void* SmearCacheFile::positionData(int frameIdx) const
+{
+    const SmearCacheHeader& h = header();
+    const uint64_t stride = static_cast<uint64_t>(h.vertexCount) * 3 * h.positionScalar;
+    return data + h.positionsOffset + stride * frameIdx;
+}
+
+const void* SmearCacheFile::offsetData(int frameIdx) const
+{
+    const SmearCacheHeader& h = header();
+    const uint64_t stride = static_cast<uint64_t>(h.vertexCount) * h.offsetScalar;
+    return data + h.offsetsOffset + stride * frameIdx;
+}
+
+void SmearCacheFile::prefetch(const void* begin, size_t bytes) const
+{
+    const uint8_t* first = static_cast<const uint8_t*>(begin);
+    if (!data || bytes == 0 || first < data || first + bytes > data + size)
+        return;
+
+#ifndef _WIN32
+    // Start readahead for the whole range, then wait for it page by page
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t pageStart = reinterpret_cast<uintptr_t>(first) & ~(pageSize - 1);
+    madvise(reinterpret_cast<void*>(pageStart), reinterpret_cast<uintptr_t>(first) + bytes - pageStart, MADV_WILLNEED);
+#else
+    const size_t pageSize = 4096;
+#endif
+    volatile uint8_t sink = 0;
+    for (size_t offset = 0; offset < bytes; offset += pageSize)
+        sink ^= first[offset];
+    sink ^= first[bytes - 1];
+}
+
+bool SmearCacheFile::isCacheFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    char magic[4] = {};
+    if (!file.read(magic, sizeof(magic)))
+        return false;
+    return std::memcmp(magic, SmearCacheFormat::kMagic, sizeof(magic)) == 0;
+}
+
+bool writeSmearCache(const std::string& path, int vertexCount, int startFrame, int endFrame, double fps,
+    const float* positions, const float* offsets, std::string& error)
+{
+    return writeCache(path, vertexCount, startFrame, endFrame, fps, positions, offsets, error);
+}
+
+bool writeSmearCache(const std::string& path, int vertexCount, int startFrame, int endFrame, double fps,
+    const double* positions, const double* offsets, std::string& error)
+{
+    return writeCache(path, vertexCount, startFrame, endFrame, fps, positions, offsets, error);
+}
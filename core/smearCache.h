@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/*
+Binary vertex cache (*.smc).
+
+Written by vertex_cache_tool.py / "loadCache -convert" and memory-mapped by
+Smear::loadCache, so loading costs the same no matter how long the shot is.
+
+Layout (little endian):
+    SmearCacheHeader                                   64 bytes
+    positions   frameCount * vertexCount * 3 scalars   frame-major, xyz interleaved
+    offsets     frameCount * vertexCount scalars       frame-major
+
+Both blocks start on a 64-byte boundary so they can be read in place.
+*/
+
+enum class SmearCacheScalar : uint32_t {
+    Float32 = 4,
+    Float64 = 8
+};
+
+struct SmearCacheHeader {
+    char     magic[4];          // "SMRC"
+    uint32_t version;
+    uint32_t vertexCount;
+    int32_t  startFrame;
+    int32_t  endFrame;          // inclusive
+    uint32_t positionScalar;    // SmearCacheScalar
+    uint32_t offsetScalar;      // SmearCacheScalar
+    uint32_t flags;             // reserved, written as 0
+    double   fps;               // frame rate the cache was baked at
+    uint64_t positionsOffset;   // byte offset of the position block
+    uint64_t offsetsOffset;     // byte offset of the offset block
+    uint64_t fileSize;
+};
+static_assert(sizeof(SmearCacheHeader) == 64, "SmearCacheHeader must stay 64 bytes");
+
+namespace SmearCacheFormat {
+    constexpr char     kMagic[4] = { 'S', 'M', 'R', 'C' };
+    constexpr uint32_t kVersion = 1;
+    constexpr uint64_t kBlockAlignment = 64;
+}
+
+// Read-only memory mapping of a binary cache file.
+class SmearCacheFile
+{
+public:
+    SmearCacheFile();
+    ~SmearCacheFile();
+    SmearCacheFile(const SmearCacheFile&) = delete;
+    SmearCacheFile& operator=(const SmearCacheFile&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    void close();
+    bool isOpen() const { return data != nullptr; }
+
+    const SmearCacheHeader& header() const { return *reinterpret_cast<const SmearCacheHeader*>(data); }
+    int frameCount() const { return isOpen() ? header().endFrame - header().startFrame + 1 : 0; }
+    int vertexCount() const { return isOpen() ? static_cast<int>(header().vertexCount) : 0; }
+    SmearCacheScalar positionScalar() const { return static_cast<SmearCacheScalar>(header().positionScalar); }
+    SmearCacheScalar offsetScalar() const { return static_cast<SmearCacheScalar>(header().offsetScalar); }
+
+    // Start of the given frame's block; cast according to positionScalar() / offsetScalar()
+    const void* positionData(int frameIdx) const;
+    const void* offsetData(int frameIdx) const;
+    // Pages [begin, begin + bytes) of the mapping into memory, blocking until they are resident
+    void prefetch(const void* begin, size_t bytes) const;
+
+    // Cheap magic-number check so callers can pick binary vs. JSON loading
+    static bool isCacheFile(const std::string& path);
+
+private:
+    const uint8_t* data;
+    size_t size;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+};
+
+// Writes a binary cache. positions holds frameCount * vertexCount * 3 values,
+// offsets frameCount * vertexCount values, both frame-major.
+bool writeSmearCache(const std::string& path, int vertexCount, int startFrame, int endFrame, double fps,
+    const float* positions, const float* offsets, std::string& error);
+bool writeSmearCache(const std::string& path, int vertexCount, int startFrame, int endFrame, double fps,
+    const double* positions, const double* offsets, std::string& error);
@@ -0,0 +1,299 @@
+#include "smearCacheJson.h"
+#include "frameStore.h"
+#include "json.hpp"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+    // SAX handler for
+    // { "vertex_count": n, "start_frame": s, "end_frame": e,
+    //   "vertex_trajectories": { "<frame>": [[x, y, z], ...], ... },
+    //   "motion_offsets": { "<frame>": [o, ...], ... },
+    //   "baked_frame_rate": fps }
+    //
+    // utils.py writes the header fields first, in which case the store is allocated
+    // before the first frame and filled in place. Otherwise frames are staged and
+    // packed into the store by finish().
+    class JsonCacheHandler : public nlohmann::json_sax<json>
+    {
+    public:
+        explicit JsonCacheHandler(FrameStore& store) : store(store) {}
+
+        bool null() override { return value(0.0); }
+        bool boolean(bool val) override { return value(val ? 1.0 : 0.0); }
+        bool number_integer(number_integer_t val) override { return value(static_cast<double>(val)); }
+        bool number_unsigned(number_unsigned_t val) override { return value(static_cast<double>(val)); }
+        bool number_float(number_float_t val, const string_t&) override { return value(val); }
+        bool string(string_t&) override { return value(0.0); }
+        bool binary(binary_t&) override { return value(0.0); }
+
+        bool start_object(std::size_t) override
+        {
+            if (skipDepth > 0 || (depth == 1 && section == Section::None && !enterSection())) {
+                ++skipDepth;
+                return true;
+            }
+            if (depth >= 2) {
+                error = "unexpected object inside " + rootKey;
+                return false;
+            }
+            ++depth;
+            return true;
+        }
+
+        bool end_object() override
+        {
+            if (skipDepth > 0) {
+                --skipDepth;
+                return true;
+            }
+            --depth;
+            if (depth == 1)
+                section = Section::None;
+            return true;
+        }
+
+        bool key(string_t& val) override
+        {
+            if (skipDepth > 0)
+                return true;
+            if (depth == 1) {
+                rootKey = val;
+                return true;
+            }
+            // Frame key inside one of the two sections
+            try {
+                frameNumber = std::stoi(val);
+            }
+            catch (const std::exception&) {
+                error = "invalid frame key \"" + val + "\"";
+                return false;
+            }
+            return true;
+        }
+
+        bool start_array(std::size_t) override
+        {
+            if (skipDepth > 0 || depth < 2) {
+                ++skipDepth;
+                return true;
+            }
+            if (depth == 2) {
+                // A frame's vertex list: write in place when the store covers it
+                element = 0;
+                target = nullptr;
+                staged = nullptr;
+                if (store.empty() && canAllocate())
+                    store.allocate(info.startFrame, info.endFrame - info.startFrame + 1, info.vertexCount);
+                const int frameIdx = store.frameIndex(frameNumber);
+                if (!store.empty() && store.hasFrame(frameIdx)) {
+                    target = section == Section::Trajectories ? store.mutablePositions(frameIdx) : store.mutableOffsets(frameIdx);
+                    capacity = static_cast<size_t>(store.vertexCount()) * (section == Section::Trajectories ? 3 : 1);
+                }
+                else if (store.empty()) {
+                    StagedFrame& frame = stagedFrames[frameNumber];
+                    staged = section == Section::Trajectories ? &frame.positions : &frame.offsets;
+                    staged->clear();
+                }
+            }
+            else if (depth == 3 && section == Section::Trajectories) {
+                component = 0;
+            }
+            else {
+                error = "unexpected array nesting in " + rootKey;
+                return false;
+            }
+            ++depth;
+            return true;
+        }
+
+        bool end_array() override
+        {
+            if (skipDepth > 0) {
+                --skipDepth;
+                return true;
+            }
+            --depth;
+            if (depth == 3)
+                ++element;  // finished one [x, y, z]
+            return true;
+        }
+
+        bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) override
+        {
+            error = std::string(ex.what()) + " (byte " + std::to_string(position) + ")";
+            return false;
+        }
+
+        bool finish()
+        {
+            if (!haveVertexCount || !sawTrajectories || !sawOffsets) {
+                error = "some fields not found";
+                return false;
+            }
+            if (store.empty()) {
+                if (!haveStartFrame)
+                    info.startFrame = stagedFrames.empty() ? 0 : stagedFrames.begin()->first;
+                if (!haveEndFrame)
+                    info.endFrame = stagedFrames.empty() ? info.startFrame : stagedFrames.rbegin()->first;
+                if (info.vertexCount <= 0 || info.endFrame < info.startFrame) {
+                    error = "empty cache";
+                    return false;
+                }
+                store.allocate(info.startFrame, info.endFrame - info.startFrame + 1, info.vertexCount, info.fps);
+                const size_t vertexCount = static_cast<size_t>(info.vertexCount);
+                for (const auto& entry : stagedFrames) {
+                    const int frameIdx = store.frameIndex(entry.first);
+                    if (!store.hasFrame(frameIdx))
+                        continue;
+                    const StagedFrame& frame = entry.second;
+                    std::copy_n(frame.positions.begin(), std::min(frame.positions.size(), vertexCount * 3), store.mutablePositions(frameIdx));
+                    std::copy_n(frame.offsets.begin(), std::min(frame.offsets.size(), vertexCount), store.mutableOffsets(frameIdx));
+                }
+            }
+            else {
+                // baked_frame_rate is written after the frame data
+                store.setFps(info.fps);
+            }
+            return true;
+        }
+
+        std::string error;
+
+    private:
+        enum class Section { None, Trajectories, Offsets };
+
+        struct JsonCacheInfo {
+            int vertexCount = 0;
+            int startFrame = 0;
+            int endFrame = 0;
+            double fps = 24.0;
+        };
+
+        struct StagedFrame {
+            std::vector<float> positions;
+            std::vector<float> offsets;
+        };
+
+        bool canAllocate() const
+        {
+            return haveVertexCount && haveStartFrame && haveEndFrame
+                && info.vertexCount > 0 && info.endFrame >= info.startFrame;
+        }
+
+        bool enterSection()
+        {
+            if (rootKey == "vertex_trajectories") {
+                section = Section::Trajectories;
+                sawTrajectories = true;
+                return true;
+            }
+            if (rootKey == "motion_offsets") {
+                section = Section::Offsets;
+                sawOffsets = true;
+                return true;
+            }
+            return false;
+        }
+
+        void storeValue(size_t index, double val)
+        {
+            if (target) {
+                if (index < capacity)
+                    target[index] = static_cast<float>(val);
+            }
+            else if (staged) {
+                if (index >= staged->size())
+                    staged->resize(index + 1, 0.0f);
+                (*staged)[index] = static_cast<float>(val);
+            }
+        }
+
+        bool value(double val)
+        {
+            if (skipDepth > 0)
+                return true;
+
+            if (depth == 1) {
+                if (rootKey == "vertex_count") {
+                    info.vertexCount = static_cast<int>(val);
+                    haveVertexCount = true;
+                }
+                else if (rootKey == "start_frame") {
+                    info.startFrame = static_cast<int>(val);
+                    haveStartFrame = true;
+                }
+                else if (rootKey == "end_frame") {
+                    info.endFrame = static_cast<int>(val);
+                    haveEndFrame = true;
+                }
+                else if (rootKey == "baked_frame_rate") {
+                    info.fps = val;
+                }
+                return true;
+            }
+
+            if (section == Section::Trajectories && depth == 4) {
+                if (component < 3)
+                    storeValue(element * 3 + component++, val);
+                return true;
+            }
+            if (section == Section::Offsets && depth == 3) {
+                storeValue(element++, val);
+                return true;
+            }
+
+            error = "unexpected value in " + rootKey;
+            return false;
+        }
+
+        FrameStore& store;
+        JsonCacheInfo info;
+        std::map<int, StagedFrame> stagedFrames;
+
+        int depth = 0;
+        int skipDepth = 0;
+        Section section = Section::None;
+        std::string rootKey;
+
+        int frameNumber = 0;
+        float* target = nullptr;
+        std::vector<float>* staged = nullptr;
+        size_t capacity = 0;
+        size_t element = 0;
+        unsigned int component = 0;
+
+        bool haveVertexCount = false;
+        bool haveStartFrame = false;
+        bool haveEndFrame = false;
+        bool sawTrajectories = false;
+        bool sawOffsets = false;
+    };
+}
+
+bool streamJsonCache(const std::string& path, FrameStore& store, std::string& error)
+{
+    // Larger read buffer than the default, the parser pulls one character at a time
+    std::vector<char> buffer(1 << 20);
+    std::ifstream file;
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        error = "could not open " + path;
+        return false;
+    }
+
+    store.clear();
+    JsonCacheHandler handler(store);
+
+    if (!json::sax_parse(file, &handler) || !handler.finish()) {
+        error = handler.error.empty() ? "malformed cache file" : handler.error;
+        store.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <string>
+
+class FrameStore;
+
+// Streams a legacy *_cache.json (as written by cache_vertex_trajectories_with_deltas
+// in scripts/utils.py) through json.hpp's SAX interface. Once vertex_count and the
+// frame range have been read, values are written straight into the store, so no DOM
+// is ever built.
+bool streamJsonCache(const std::string& path, FrameStore& store, std::string& error);
@@ -0,0 +1,126 @@
+#include "smearDeltas.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace {
+    struct Vec3 {
+        double x, y, z;
+    };
+
+    Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    Vec3 operator+(const Vec3& a, const Vec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+    Vec3 operator*(const Vec3& a, double s) { return { a.x * s, a.y * s, a.z * s }; }
+    double dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    double length(const Vec3& a) { return std::sqrt(dot(a, a)); }
+    Vec3 load(const float* p) { return { p[0], p[1], p[2] }; }
+
+    // Temporal smoothing as np.convolve(..., mode='same') with a normalised kernel,
+    // frames past either end count as zero
+    void smoothOffsets(std::vector<float>& raw, int frameCount, int vertexCount, int window, float* offsets)
+    {
+        std::vector<double> kernel(2 * window + 1);
+        double kernelSum = 0.0;
+        for (int n = -window; n <= window; ++n) {
+            const double normalized = n / static_cast<double>(window + 1);
+            kernel[n + window] = std::pow(1.0 - normalized * normalized, 2.0);
+            kernelSum += kernel[n + window];
+        }
+
+        for (int f = 0; f < frameCount; ++f) {
+            float* out = offsets + static_cast<size_t>(f) * vertexCount;
+            std::fill(out, out + vertexCount, 0.0f);
+            for (int n = -window; n <= window; ++n) {
+                const int source = f + n;
+                if (source < 0 || source >= frameCount)
+                    continue;
+                const float w = static_cast<float>(kernel[n + window] / kernelSum);
+                const float* in = raw.data() + static_cast<size_t>(source) * vertexCount;
+                for (int v = 0; v < vertexCount; ++v)
+                    out[v] += w * in[v];
+            }
+        }
+    }
+}
+
+void computeArticulatedDeltas(const float* positions, const BonePose* poses, const float* weights,
+    int frameCount, int vertexCount, int boneCount, int window, float* offsets)
+{
+    if (frameCount <= 0 || vertexCount <= 0)
+        return;
+
+    // Most vertices are bound to a handful of bones, only visit the non-zero weights
+    std::vector<std::vector<std::pair<int, float>>> boneVertices(boneCount);
+    for (int v = 0; v < vertexCount; ++v) {
+        for (int k = 0; k < boneCount; ++k) {
+            const float w = weights[static_cast<size_t>(v) * boneCount + k];
+            if (w != 0.0f)
+                boneVertices[k].emplace_back(v, w);
+        }
+    }
+
+    std::vector<float> raw(static_cast<size_t>(frameCount) * vertexCount, 0.0f);
+
+    for (int f = 0; f < frameCount; ++f) {
+        const float* framePositions = positions + static_cast<size_t>(f) * vertexCount * 3;
+        float* frameDeltas = raw.data() + static_cast<size_t>(f) * vertexCount;
+
+        // Central differences inside the range, one-sided at the ends
+        const int prev = std::max(f - 1, 0);
+        const int next = std::min(f + 1, frameCount - 1);
+
+        for (int k = 0; k < boneCount; ++k) {
+            const BonePose& pose = poses[static_cast<size_t>(f) * boneCount + k];
+            const Vec3 head = load(pose.head);
+            const Vec3 axis = load(pose.tail) - head;
+            const double boneLength = length(axis);
+            if (boneLength < 1e-5)
+                continue;
+            const Vec3 bHat = axis * (1.0 / boneLength);
+
+            // Velocity direction at the root and the tip of the bone
+            const BonePose& before = poses[static_cast<size_t>(prev) * boneCount + k];
+            const BonePose& after = poses[static_cast<size_t>(next) * boneCount + k];
+            const Vec3 v0 = load(after.head) - load(before.head);
+            const Vec3 v1 = load(after.tail) - load(before.tail);
+            const Vec3 v0Hat = v0 * (1.0 / (length(v0) + 1e-8));
+            const Vec3 v1Hat = v1 * (1.0 / (length(v1) + 1e-8));
+
+            for (const auto& [v, w] : boneVertices[k]) {
+                const Vec3 toVertex = load(framePositions + static_cast<size_t>(v) * 3) - head;
+
+                // Position along the bone, smoothstepped
+                const double u = std::clamp(dot(toVertex, bHat) / boneLength, 0.0, 1.0);
+                const double uSmooth = 3.0 * u * u - 2.0 * u * u * u;
+
+                Vec3 vHat = v0Hat * (1.0 - uSmooth) + v1Hat * uSmooth;
+                vHat = vHat * (1.0 / (length(vHat) + 1e-8));
+
+                // Ribbon normal
+                const double vDotB = dot(vHat, bHat);
+                Vec3 nHat = vHat - bHat * vDotB;
+                const double nHatLength = length(nHat);
+                if (nHatLength < 1e-8)
+                    continue;
+                nHat = nHat * (1.0 / nHatLength);
+
+                const double deltaRaw = dot(toVertex, nHat);
+                const double colinearity = 1.0 - vDotB * vDotB;
+                frameDeltas[v] += static_cast<float>(w * colinearity * deltaRaw);
+            }
+        }
+    }
+
+    smoothOffsets(raw, frameCount, vertexCount, window, offsets);
+
+    // Normalise to [-1, 1] by the largest magnitude over the whole shot
+    float maxMagnitude = 0.0f;
+    const size_t count = static_cast<size_t>(frameCount) * vertexCount;
+    for (size_t i = 0; i < count; ++i)
+        maxMagnitude = std::max(maxMagnitude, std::abs(offsets[i]));
+    if (maxMagnitude > 1e-6f) {
+        for (size_t i = 0; i < count; ++i)
+            offsets[i] /= maxMagnitude;
+    }
+}
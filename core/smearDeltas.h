@@ -0,0 +1,22 @@
+#pragma once
+
+// World-space joint head and tail (first child joint, or the head again for leaf joints)
+struct BonePose {
+    float head[3];
+    float tail[3];
+};
+
+/*
+Articulated motion offsets, the native version of build_deltas in scripts/utils.py.
+
+    positions   frameCount * vertexCount * 3 world-space positions, frame-major
+    poses       frameCount * boneCount bone poses, frame-major
+    weights     vertexCount * boneCount dense skin weights
+    offsets     frameCount * vertexCount output, frame-major
+
+Each vertex's offset is the skin-weighted signed distance to the plane spanned by
+its bone and the bone's motion direction. The offsets are then smoothed over
+time with the (1 - (n / (window + 1))^2)^2 kernel and normalised to [-1, 1].
+*/
+void computeArticulatedDeltas(const float* positions, const BonePose* poses, const float* weights,
+    int frameCount, int vertexCount, int boneCount, int window, float* offsets);
@@ -0,0 +1,67 @@
+#include "smearMotion.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+    void transformPoint(const double* m, const double p[3], double out[3])
+    {
+        for (int c = 0; c < 3; ++c)
+            out[c] = p[0] * m[0 * 4 + c] + p[1] * m[1 * 4 + c] + p[2] * m[2 * 4 + c] + m[3 * 4 + c];
+    }
+}
+
+void computeSimpleOffsets(const float* restPositions, int vertexCount, const double* matrices, int frameCount,
+    int firstFrame, int lastFrame, float* offsets)
+{
+    if (vertexCount <= 0 || frameCount <= 0)
+        return;
+    firstFrame = std::max(0, firstFrame);
+    lastFrame = std::min(frameCount - 1, lastFrame);
+
+    // Centroid of the rest points, carried along by each frame's matrix
+    double centroidLocal[3] = { 0.0, 0.0, 0.0 };
+    for (int v = 0; v < vertexCount; ++v) {
+        for (int c = 0; c < 3; ++c)
+            centroidLocal[c] += restPositions[v * 3 + c];
+    }
+    for (int c = 0; c < 3; ++c)
+        centroidLocal[c] /= vertexCount;
+
+    for (int f = firstFrame; f <= lastFrame; ++f) {
+        const double* matrix = matrices + static_cast<size_t>(f) * 16;
+
+        double centroid[3];
+        transformPoint(matrix, centroidLocal, centroid);
+
+        // Velocity towards the next frame; a single frame has none
+        double normal[3] = { 0.0, 0.0, 0.0 };
+        if (frameCount > 1) {
+            const int from = std::min(f, frameCount - 2);
+            double a[3], b[3];
+            transformPoint(matrices + static_cast<size_t>(from) * 16, centroidLocal, a);
+            transformPoint(matrices + static_cast<size_t>(from + 1) * 16, centroidLocal, b);
+            const double velocity[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const double length = std::sqrt(velocity[0] * velocity[0] + velocity[1] * velocity[1] + velocity[2] * velocity[2]);
+            if (length > 0.0) {
+                for (int c = 0; c < 3; ++c)
+                    normal[c] = velocity[c] / length;
+            }
+        }
+
+        float* frameOffsets = offsets + static_cast<size_t>(f) * vertexCount;
+        double maxMagnitude = DBL_MIN;
+        for (int v = 0; v < vertexCount; ++v) {
+            const double rest[3] = { restPositions[v * 3 + 0], restPositions[v * 3 + 1], restPositions[v * 3 + 2] };
+            double world[3];
+            transformPoint(matrix, rest, world);
+            const double distance = (world[0] - centroid[0]) * normal[0] + (world[1] - centroid[1]) * normal[1] + (world[2] - centroid[2]) * normal[2];
+            frameOffsets[v] = static_cast<float>(distance);
+            maxMagnitude = std::max(maxMagnitude, std::abs(distance));
+        }
+
+        for (int v = 0; v < vertexCount; ++v) {
+            const double normalized = frameOffsets[v] / maxMagnitude;
+            frameOffsets[v] = static_cast<float>(std::max(-1.0, std::min(1.0, normalized)));
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cmath>
+
+/*
+Motion offsets for simple (rigid, unskinned) objects, the math behind
+Smear::computeMotionOffsetsSimple without any Maya types.
+
+    restPositions   vertexCount * 3 object-space positions
+    matrices        frameCount 4x4 row-major matrices in Maya's row-vector convention (p' = p * M)
+    offsets         frameCount * vertexCount output, frame-major
+
+Each frame moves the centroid of the rest points by its matrix; the centroid's
+velocity is the step to the next frame (the last frame reuses the step before
+it). A vertex's offset is its signed distance to the plane through the centroid
+facing that velocity, normalised by the frame's largest magnitude. Only frames
+[firstFrame, lastFrame] are written.
+*/
+void computeSimpleOffsets(const float* restPositions, int vertexCount, const double* matrices, int frameCount,
+    int firstFrame, int lastFrame, float* offsets);
+
+// Where on its trajectory a vertex is drawn: Catmull-Rom segment starting at baseFrame, parameter t
+struct ElongationSample {
+    int baseFrame;
+    float t;
+};
+
+// Sample beta frames away from frameTime; a fractional frameTime carries into t
+inline ElongationSample elongationAt(double frameTime, double beta)
+{
+    const double position = frameTime + beta;
+    const double baseFrame = std::floor(position);
+    return { static_cast<int>(baseFrame), static_cast<float>(position - baseFrame) };
+}
+
+// Simple objects blend the past and future strengths by the offset (remapped from [-1, 1] to [0, 1])
+inline ElongationSample elongationSample(double offset, double strengthPast, double strengthFuture, double frameTime)
+{
+    const double blend = (offset + 1.0) / 2.0;
+    const double strength = (1.0 - blend) * strengthPast + blend * strengthFuture;
+    return elongationAt(frameTime, offset * strength);
+}
+
+// Articulated objects use the past strength for trailing and the future strength for leading vertices
+inline ElongationSample articulatedElongationSample(double offset, double strengthPast, double strengthFuture, double frameTime)
+{
+    return elongationAt(frameTime, offset * (offset < 0.0 ? strengthPast : strengthFuture));
+}
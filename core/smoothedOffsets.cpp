@@ -0,0 +1,100 @@
+#include "smoothedOffsets.h"
+#include <cmath>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+bool SmoothedOffsets::update(const FrameStore& frames, int window)
+{
+    window = std::max(0, window);
+    if (m_source == &frames && m_window == window &&
+        m_frameCount == frames.frameCount() && m_vertexCount == frames.vertexCount())
+        return false;
+
+    m_source = &frames;
+    m_window = window;
+    m_frameCount = frames.frameCount();
+    m_vertexCount = frames.vertexCount();
+    m_offsets.clear();
+    m_kernel.clear();
+    if (window == 0 || frames.empty()) {
+        m_offsets.shrink_to_fit();
+        return true;
+    }
+
+    // Kernel table, so building the cache never calls pow per sample
+    m_kernel.resize(2 * window + 1);
+    for (int n = -window; n <= window; ++n) {
+        const double normalized = std::abs(n) / static_cast<double>(window + 1);
+        const double falloff = 1.0 - normalized * normalized;
+        m_kernel[n + window] = static_cast<float>(falloff * falloff);
+    }
+
+    m_offsets.assign(static_cast<size_t>(m_frameCount) * m_vertexCount, 0.0f);
+    smoothFrames(0, m_frameCount - 1);
+    return true;
+}
+
+bool SmoothedOffsets::refresh(const FrameStore& frames, int firstIndex, int lastIndex)
+{
+    if (firstIndex > lastIndex || m_source == nullptr)
+        return false;
+    if (m_source != &frames || m_frameCount != frames.frameCount() || m_vertexCount != frames.vertexCount()) {
+        invalidate();
+        return false;
+    }
+    if (m_window == 0)
+        return false;
+
+    // Every frame whose window reaches into the re-baked span
+    smoothFrames(std::max(0, firstIndex - m_window), std::min(m_frameCount - 1, lastIndex + m_window));
+    return true;
+}
+
+void SmoothedOffsets::invalidate()
+{
+    m_source = nullptr;
+    m_window = -1;
+    m_frameCount = 0;
+    m_vertexCount = 0;
+    m_offsets.clear();
+    m_offsets.shrink_to_fit();
+    m_kernel.clear();
+}
+
+const float* SmoothedOffsets::offsets(int frameIndex) const
+{
+    if (m_window == 0)
+        return m_source->offsets(frameIndex);
+    return m_offsets.data() + static_cast<size_t>(frameIndex) * m_vertexCount;
+}
+
+void SmoothedOffsets::smoothFrames(int firstIndex, int lastIndex)
+{
+    const FrameStore& frames = *m_source;
+    const int window = m_window;
+    const int frameCount = m_frameCount;
+    const int vertexCount = m_vertexCount;
+
+    // Frames are independent; each one is a weighted sum of whole offset rows
+    tbb::parallel_for(tbb::blocked_range<int>(firstIndex, lastIndex + 1), [&](const tbb::blocked_range<int>& range) {
+        for (int f = range.begin(); f != range.end(); ++f) {
+            float* out = m_offsets.data() + static_cast<size_t>(f) * vertexCount;
+            std::fill(out, out + vertexCount, 0.0f);
+            const int first = std::max(0, f - window);
+            const int last = std::min(frameCount - 1, f + window);
+
+            float totalWeight = 0.0f;
+            for (int k = first; k <= last; ++k) {
+                const float weight = m_kernel[k - f + window];
+                const float* row = frames.offsets(k);
+                for (int v = 0; v < vertexCount; ++v)
+                    out[v] += weight * row[v];
+                totalWeight += weight;
+            }
+
+            const float scale = 1.0f / totalWeight;
+            for (int v = 0; v < vertexCount; ++v)
+                out[v] *= scale;
+        }
+    });
+}
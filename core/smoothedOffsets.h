@@ -0,0 +1,43 @@
+#pragma once
+#include "frameStore.h"
+#include <vector>
+
+/*
+Temporally smoothed motion offsets for every frame of a FrameStore.
+
+    smoothed[f][v] = sum_n w(n) * offsets[f + n][v] / sum_n w(n),  n in [-window, window]
+    w(n) = (1 - (|n| / (window + 1))^2)^2
+
+Frames outside the store are left out of both sums. The table is built once
+and only rebuilt when the source store or the window changes; a window of 0
+reads the store's offsets directly. When some frames are re-baked in place,
+refresh() recomputes just the frames whose window reaches them.
+*/
+
+class SmoothedOffsets
+{
+public:
+    // Cheap when nothing changed; true when the table had to be rebuilt
+    bool update(const FrameStore& frames, int window);
+    // Frames [firstIndex, lastIndex] of frames got new offsets; an empty range does nothing.
+    // True when any smoothed frame was recomputed
+    bool refresh(const FrameStore& frames, int firstIndex, int lastIndex);
+    void invalidate();
+
+    bool empty() const { return m_source == nullptr; }
+    int window() const { return m_window; }
+    size_t residentBytes() const { return m_offsets.capacity() * sizeof(float); }
+
+    const float* offsets(int frameIndex) const;
+    float offset(int frameIndex, int vertexIndex) const { return offsets(frameIndex)[vertexIndex]; }
+
+private:
+    void smoothFrames(int firstIndex, int lastIndex);
+
+    const FrameStore* m_source = nullptr;
+    int m_window = -1;
+    int m_frameCount = 0;
+    int m_vertexCount = 0;
+    std::vector<float> m_offsets;
+    std::vector<float> m_kernel;
+};
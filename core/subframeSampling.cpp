@@ -0,0 +1,118 @@
+#include "subframeSampling.h"
+#include "catmullRom.h"
+#include "smearMotion.h"
+#include <algorithm>
+#include <cmath>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+namespace {
+    // Vertices per parallel task, as in the deformer
+    const int kGrainSize = 2048;
+    // How far off the grid a sub-sample may be, in steps; MTime rounds to ticks, not to exact fractions
+    const double kGridTolerance = 0.05;
+}
+
+void sampleElongated(const FrameStore& frames, const SmoothedOffsets& offsets, const ElongationParams& params,
+    const int* vertexIds, int count, const double* times, int timeCount, float* out)
+{
+    if (count <= 0 || timeCount <= 0 || frames.empty())
+        return;
+
+    const int lastFrame = frames.frameCount() - 1;
+    tbb::parallel_for(tbb::blocked_range<int>(0, count, kGrainSize), [&](const tbb::blocked_range<int>& range) {
+        const int begin = range.begin();
+        const int n = static_cast<int>(range.size());
+        std::vector<int> baseFrames(n);
+        std::vector<float> t(n);
+
+        // All times of a chunk back to back, while its trajectories are still in cache
+        for (int s = 0; s < timeCount; ++s) {
+            const double time = std::clamp(times[s], 0.0, static_cast<double>(lastFrame));
+            const int frame = static_cast<int>(std::floor(time));
+            const float blend = static_cast<float>(time - frame);
+            const float* offsets0 = offsets.offsets(frame);
+            const float* offsets1 = offsets.offsets(std::min(frame + 1, lastFrame));
+
+            for (int i = 0; i < n; ++i) {
+                const int v = vertexIds[begin + i];
+                const double offset = offsets0[v] + (offsets1[v] - offsets0[v]) * blend;
+                const ElongationSample sample = params.mode == ElongationMode::Simple
+                    ? elongationSample(offset, params.strengthPast, params.strengthFuture, time)
+                    : articulatedElongationSample(offset, params.strengthPast, params.strengthFuture, time);
+                baseFrames[i] = sample.baseFrame;
+                t[i] = sample.t;
+            }
+
+            float* target = out + (static_cast<size_t>(s) * count + begin) * 3;
+            sampleTrajectories(frames, vertexIds + begin, baseFrames.data(), t.data(), n, target);
+        }
+    });
+}
+
+const float* SubframeBatch::positions(const FrameStore& frames, const SmoothedOffsets& offsets, const ElongationParams& params,
+    const int* vertexIds, int count, double time, const Shutter& shutter, bool* hit)
+{
+    if (hit)
+        *hit = false;
+    if (shutter.samples < 2 || !(shutter.close > shutter.open))
+        return nullptr;
+
+    // The frame whose grid holds time, and the sample it is
+    const double step = (shutter.close - shutter.open) / (shutter.samples - 1);
+    double frame = 0.0;
+    int sample = -1;
+    for (double f = std::ceil(time - shutter.close - kGridTolerance * step); f <= time - shutter.open + kGridTolerance * step; ++f) {
+        const double k = (time - f - shutter.open) / step;
+        const double nearest = std::round(k);
+        if (nearest >= 0.0 && nearest < shutter.samples && std::abs(k - nearest) <= kGridTolerance) {
+            frame = f;
+            sample = static_cast<int>(nearest);
+            break;
+        }
+    }
+    if (sample < 0)
+        return nullptr;
+
+    if (matches(frames, offsets, params, vertexIds, count, shutter) && m_frame == frame) {
+        if (hit)
+            *hit = true;
+        return m_positions.data() + static_cast<size_t>(sample) * count * 3;
+    }
+
+    m_frames = &frames;
+    m_offsets = &offsets;
+    m_window = offsets.window();
+    m_params = params;
+    m_shutter = shutter;
+    m_frame = frame;
+    m_vertexIds.assign(vertexIds, vertexIds + count);
+
+    std::vector<double> times(shutter.samples);
+    for (int s = 0; s < shutter.samples; ++s)
+        times[s] = frame + shutter.open + s * step;
+    m_positions.resize(static_cast<size_t>(shutter.samples) * count * 3);
+    sampleElongated(frames, offsets, params, vertexIds, count, times.data(), shutter.samples, m_positions.data());
+
+    return m_positions.data() + static_cast<size_t>(sample) * count * 3;
+}
+
+void SubframeBatch::invalidate()
+{
+    m_frames = nullptr;
+    m_offsets = nullptr;
+    m_vertexIds.clear();
+    m_vertexIds.shrink_to_fit();
+    m_positions.clear();
+    m_positions.shrink_to_fit();
+}
+
+bool SubframeBatch::matches(const FrameStore& frames, const SmoothedOffsets& offsets, const ElongationParams& params,
+    const int* vertexIds, int count, const Shutter& shutter) const
+{
+    return m_frames == &frames && m_offsets == &offsets && m_window == offsets.window() &&
+        m_params.strengthPast == params.strengthPast && m_params.strengthFuture == params.strengthFuture &&
+        m_params.mode == params.mode &&
+        m_shutter.open == shutter.open && m_shutter.close == shutter.close && m_shutter.samples == shutter.samples &&
+        static_cast<int>(m_vertexIds.size()) == count && std::equal(m_vertexIds.begin(), m_vertexIds.end(), vertexIds);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "frameStore.h"
+#include "smoothedOffsets.h"
+#include <vector>
+
+/*
+Elongated vertex positions at fractional frame indices, one or several at a time.
+
+At a time between two frames a vertex's offset is the linear blend of the two
+frames' smoothed offsets, and the elongation starts from the fractional frame
+itself, so the fraction ends up in the Catmull-Rom parameter and sub-frame
+evaluations move continuously instead of holding the frame below. The result
+at a whole frame matches elongationSample/articulatedElongationSample.
+
+sampleElongated evaluates timeCount times in one pass over the vertices; out
+holds timeCount blocks of count xyz triples, in the order of times.
+*/
+
+enum class ElongationMode {
+    Simple,      // strengths blended by the offset, see elongationSample
+    Articulated  // past strength trails, future strength leads, see articulatedElongationSample
+};
+
+struct ElongationParams {
+    double strengthPast = 1.5;
+    double strengthFuture = 1.5;
+    ElongationMode mode = ElongationMode::Simple;
+};
+
+// offsets must be up to date for frames; times are frame indices into frames, clamped to the store
+void sampleElongated(const FrameStore& frames, const SmoothedOffsets& offsets, const ElongationParams& params,
+    const int* vertexIds, int count, const double* times, int timeCount, float* out);
+
+/*
+A renderer's motion-blur sample times: samples evenly spaced times from
+frame + open to frame + close, for every whole frame. open and close are in
+frames, so -0.25 and 0.25 is a centred half-frame shutter.
+*/
+struct Shutter {
+    double open = -0.25;
+    double close = 0.25;
+    int samples = 1;
+};
+
+/*
+Motion-blur sub-samples of one frame, evaluated together and handed out one
+at a time.
+
+The first time on the shutter's grid of a frame evaluates all of that frame's
+sample times; the others, in any order, are copies. A time off the grid
+returns nullptr and leaves the batch alone, the caller evaluates it on its
+own. The caller drops the batch with invalidate() whenever the frames or
+offsets change in place.
+*/
+class SubframeBatch
+{
+public:
+    // Positions at time, count xyz triples, or nullptr when time is not one of shutter's sample times;
+    // hit is set when they came from the current batch
+    const float* positions(const FrameStore& frames, const SmoothedOffsets& offsets, const ElongationParams& params,
+        const int* vertexIds, int count, double time, const Shutter& shutter, bool* hit = nullptr);
+    void invalidate();
+    size_t residentBytes() const { return m_positions.capacity() * sizeof(float) + m_vertexIds.capacity() * sizeof(int); }
+
+private:
+    bool matches(const FrameStore& frames, const SmoothedOffsets& offsets, const ElongationParams& params,
+        const int* vertexIds, int count, const Shutter& shutter) const;
+
+    const FrameStore* m_frames = nullptr;
+    const SmoothedOffsets* m_offsets = nullptr;
+    int m_window = -1;
+    ElongationParams m_params;
+    Shutter m_shutter;
+    double m_frame = 0.0;
+    std::vector<int> m_vertexIds;
+    std::vector<float> m_positions;
+};
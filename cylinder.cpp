@@ -1,22 +1,15 @@
 #include "cylinder.h"
 #include <maya/MMatrix.h>
 #include <math.h>
+#include <algorithm>
 
-MPointArray CylinderMesh::gPoints;
-MVectorArray CylinderMesh::gNormals;
-MIntArray CylinderMesh::gFaceCounts;
-MIntArray CylinderMesh::gFaceConnects;
-double CylinderMesh::gLastRadius; 
+std::map<int, CylinderTemplate> CylinderMesh::gTemplates;
+std::mutex CylinderMesh::gTemplatesMutex;
 
 CylinderMesh::CylinderMesh(
-   const MPoint& start, const MPoint& end, double _r) : 
-    mStart(start), mEnd(end), r(_r)
+   const MPoint& start, const MPoint& end, double _r, int slices) : 
+    mStart(start), mEnd(end), r(_r), mTemplate(&unitTemplate(slices))
 {
-    gLastRadius = -1.0;
-    if (gPoints.length() == 0 || std::abs(gLastRadius - r) > 1e-6) {
-        initCylinderMesh(r);
-        gLastRadius = r;
-    }
 }
 
 CylinderMesh::~CylinderMesh(){}
@@ -27,17 +20,8 @@ void CylinderMesh::transform(MPointArray& points, MVectorArray& normals)
     double s = forward.length();
     forward.normalize();
 
-    MVector left = MVector(0,0,1)^forward;
-    MVector up;
-    if (left.length() < 0.0001)
-    {
-        up = forward^MVector(0,1,0);
-        left = up^forward;
-    }
-    else
-    {
-        up = forward^left;
-    }
+    MVector left, up;
+    basis(forward, left, up);
 
     MMatrix mat;
     mat[0][0] = forward[0]; mat[0][1] = left[0]; mat[0][2] = up[0]; mat[0][3] = 0;
@@ -46,18 +30,58 @@ void CylinderMesh::transform(MPointArray& points, MVectorArray& normals)
     mat[3][0] = 0;            mat[3][1] = 0;       mat[3][2] = 0;     mat[3][3] = 1;
     mat = mat.transpose();
 
-    for (int i = 0; i < gPoints.length(); i++)
+    for (unsigned int i = 0; i < mTemplate->points.length(); i++)
     {
-        MPoint p = gPoints[i];
+        MPoint p = mTemplate->points[i];
         p.x = p.x * s; // scale
+        p.y = p.y * r;
+        p.z = p.z * r;
         p = p * mat + mStart; // transform
         points.append(p);
 
-        MVector n = gNormals[i] * mat;
+        MVector n = mTemplate->normals[i] * mat;
         normals.append(n);
     }
 }
 
+void CylinderMesh::basis(const MVector& forward, MVector& left, MVector& up)
+{
+    left = MVector(0,0,1)^forward;
+    if (left.length() < 0.0001)
+    {
+        up = forward^MVector(0,1,0);
+        left = up^forward;
+    }
+    else
+    {
+        left.normalize();
+        up = forward^left;
+    }
+}
+
+const CylinderTemplate& CylinderMesh::unitTemplate(int slices)
+{
+    slices = std::clamp(slices, kMinSlices, kMaxSlices);
+    std::lock_guard<std::mutex> lock(gTemplatesMutex);
+    auto found = gTemplates.find(slices);
+    if (found != gTemplates.end())
+        return found->second;
+
+    CylinderTemplate& cylinder = gTemplates[slices];
+    initCylinderMesh(slices, cylinder);
+    return cylinder;
+}
+
+int CylinderMesh::lodSlices(double r, double distance, int maxSlices)
+{
+    // Allowed gap between the slices and the true circle: about a pixel of a 1000 pixel
+    // wide view at that distance, 1 mm when the distance is unknown
+    const double tolerance = 0.001 * std::max(distance, 1.0);
+    // The gap of n slices is r * (1 - cos(pi / n)), about r * pi^2 / (2 n^2)
+    const int slices = static_cast<int>(std::ceil(M_PI * std::sqrt(std::max(r, 0.0) / (2.0 * tolerance))));
+    return std::clamp(slices, kMinSlices, std::clamp(maxSlices, kMinSlices, kMaxSlices));
+}
+
 void CylinderMesh::appendToMesh(
     MPointArray& points, 
     MIntArray& faceCounts, 
@@ -68,18 +92,18 @@ void CylinderMesh::appendToMesh(
     transform(cpoints, cnormals);    
 
     int startIndex = points.length(); // offset for indexes
-    for (int i = 0; i < cpoints.length(); i++)
+    for (unsigned int i = 0; i < cpoints.length(); i++)
     {
         points.append(cpoints[i]);
     }
-    for (int i = 0; i < gFaceCounts.length(); i++)
+    for (unsigned int i = 0; i < mTemplate->faceCounts.length(); i++)
     {
-        faceCounts.append(gFaceCounts[i]);
+        faceCounts.append(mTemplate->faceCounts[i]);
     }
 
-    for (int i = 0; i < gFaceConnects.length(); i++)
+    for (unsigned int i = 0; i < mTemplate->faceConnects.length(); i++)
     {
-        faceConnects.append(gFaceConnects[i]+startIndex);
+        faceConnects.append(mTemplate->faceConnects[i]+startIndex);
     }
 }
 
@@ -90,66 +114,66 @@ void CylinderMesh::getMesh(
 {
     MVectorArray cnormals; 
     transform(points, cnormals);    
-    faceCounts = gFaceCounts;
-    faceConnects = gFaceConnects;
+    faceCounts = mTemplate->faceCounts;
+    faceConnects = mTemplate->faceConnects;
 }
 
-void CylinderMesh::initCylinderMesh(double r)
+void CylinderMesh::initCylinderMesh(int numslices, CylinderTemplate& cylinder)
 {
-    int numslices = 10;
     double angle = M_PI*2/numslices;
+    cylinder.slices = numslices;
+    MPointArray& points = cylinder.points;
+    MVectorArray& normals = cylinder.normals;
+    MIntArray& faceCounts = cylinder.faceCounts;
+    MIntArray& faceConnects = cylinder.faceConnects;
 
     // Add points and normals
-    gPoints.clear();
-    gNormals.clear();
-    gFaceCounts.clear();
-    gFaceConnects.clear();
 
     for (int i = 0; i < numslices; i++)
     {
-        gPoints.append(MPoint(0,r*cos(angle*i), r*sin(angle*i)));
-        gNormals.append(MVector(0,r*cos(angle*i), r*sin(angle*i)));
+        points.append(MPoint(0,cos(angle*i), sin(angle*i)));
+        normals.append(MVector(0,cos(angle*i), sin(angle*i)));
     }
     for (int i = 0; i < numslices; i++)
     {
-        gPoints.append(MPoint(1,r*cos(angle*i), r*sin(angle*i)));
-        gNormals.append(MVector(0,r*cos(angle*i), r*sin(angle*i)));
+        points.append(MPoint(1,cos(angle*i), sin(angle*i)));
+        normals.append(MVector(0,cos(angle*i), sin(angle*i)));
     }
     // endcap 1
-    gPoints.append(MPoint(0,0,0));
-    gNormals.append(MVector(-1,0,0));
+    points.append(MPoint(0,0,0));
+    normals.append(MVector(-1,0,0));
 
     // endcap 2
-    gPoints.append(MPoint(1,0,0));
-    gNormals.append(MVector(1,0,0));
+    points.append(MPoint(1,0,0));
+    normals.append(MVector(1,0,0));
 
     // Set indices for endcap 1
     for (int i = 0; i < numslices; i++)
     {
-        gFaceCounts.append(3); // append triangle
-        gFaceConnects.append(2*numslices);
-        gFaceConnects.append((i+1)%numslices);
-        gFaceConnects.append(i);
+        faceCounts.append(3); // append triangle
+        faceConnects.append(2*numslices);
+        faceConnects.append((i+1)%numslices);
+        faceConnects.append(i);
     }
     
     // Set indices for endcap 2
     for (int i = numslices; i < 2*numslices; i++)
     {
-        gFaceCounts.append(3); // append triangle
-        gFaceConnects.append(2*numslices+1);
-        gFaceConnects.append(i);
+        faceCounts.append(3); // append triangle
+        faceConnects.append(2*numslices+1);
+        faceConnects.append(i);
         int next = i+1;
         if (next >= 2*numslices) next = numslices;
-        gFaceConnects.append(next);
+        faceConnects.append(next);
     }
 
     // Set indices for middle
     for (int i = 0; i < numslices; i++)
     {
-        gFaceCounts.append(4); // append quad
-        gFaceConnects.append(i);
-        gFaceConnects.append((i+1)%numslices);
-        gFaceConnects.append((i+1)%numslices+numslices);
-        gFaceConnects.append(i+numslices);
+        faceCounts.append(4); // append quad
+        faceConnects.append(i);
+        faceConnects.append((i+1)%numslices);
+        faceConnects.append((i+1)%numslices+numslices);
+        faceConnects.append(i+numslices);
     }
 }
@@ -8,11 +8,23 @@
 #include <maya/MVectorArray.h>
 #include <maya/MIntArray.h>
 #include <maya/MDoubleArray.h>
+#include <map>
+#include <mutex>
+
+// Cylinder from (0,0,0) to (1,0,0) with radius 1; instances scale it by length and radius
+struct CylinderTemplate
+{
+    int slices;
+    MPointArray points;
+    MVectorArray normals;
+    MIntArray faceCounts;
+    MIntArray faceConnects;
+};
 
 class CylinderMesh
 {
 public:
-    CylinderMesh(const MPoint& start, const MPoint& end, double r = 0.25);
+    CylinderMesh(const MPoint& start, const MPoint& end, double r = 0.25, int slices = kDefaultSlices);
     ~CylinderMesh();
 
     void getMesh(
@@ -25,19 +37,28 @@ public:
         MIntArray& faceCounts, 
         MIntArray& faceConnects);
 
+    static const int kDefaultSlices = 10;
+    static const int kMinSlices = 3;
+    static const int kMaxSlices = 64;
+
+    // Built the first time a slice count is asked for, then shared by every cylinder
+    static const CylinderTemplate& unitTemplate(int slices);
+    // Level of detail: enough slices that the outline stays within about a pixel of a true
+    // circle at distance (0 when unknown), so thin or distant cylinders get fewer
+    static int lodSlices(double r, double distance, int maxSlices);
+    // Orthonormal frame around a unit direction, the template's x axis maps to forward
+    static void basis(const MVector& forward, MVector& left, MVector& up);
+
 protected:
     void transform(MPointArray& points, MVectorArray& normals);
     MPoint mStart;
     MPoint mEnd;
     double r;
+    const CylinderTemplate* mTemplate;
 
-    // Creates a unit cylinder from (0,0,0) to (1,0,0) with radius r
-    static void initCylinderMesh(double r);
-    static MPointArray gPoints;
-    static MVectorArray gNormals;
-    static MIntArray gFaceCounts;
-    static MIntArray gFaceConnects;
-    static double gLastRadius;
+    static void initCylinderMesh(int slices, CylinderTemplate& cylinder);
+    static std::map<int, CylinderTemplate> gTemplates;
+    static std::mutex gTemplatesMutex;
 };
 
-#endif
\ No newline at end of file
+#endif
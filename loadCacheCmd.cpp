@@ -1,23 +1,152 @@
 #include "loadCacheCmd.h"
 #include "smear.h"
+#include <maya/MArgDatabase.h>
+#include <maya/MFnDependencyNode.h>
+#include <maya/MPlug.h>
+#include <maya/MSelectionList.h>
+#include <maya/MStringArray.h>
+#include <algorithm>
+
+static const char* kConvertFlag = "-cv";
+static const char* kConvertFlagLong = "-convert";
+static const char* kNodeFlag = "-n";
+static const char* kNodeFlagLong = "-node";
+static const char* kBudgetFlag = "-mb";
+static const char* kBudgetFlagLong = "-memoryBudget";
+static const char* kCompressFlag = "-cmp";
+static const char* kCompressFlagLong = "-compress";
+static const char* kToleranceFlag = "-tol";
+static const char* kToleranceFlagLong = "-tolerance";
+static const char* kOffsetBitsFlag = "-ob";
+static const char* kOffsetBitsFlagLong = "-offsetBits";
+
+MSyntax LoadCacheCmd::newSyntax()
+{
+    MSyntax syntax;
+    syntax.addFlag(kConvertFlag, kConvertFlagLong);
+    syntax.addFlag(kNodeFlag, kNodeFlagLong, MSyntax::kString);
+    syntax.makeFlagMultiUse(kNodeFlag);
+    syntax.addFlag(kBudgetFlag, kBudgetFlagLong, MSyntax::kDouble);
+    syntax.addFlag(kCompressFlag, kCompressFlagLong, MSyntax::kBoolean);
+    syntax.addFlag(kToleranceFlag, kToleranceFlagLong, MSyntax::kDouble);
+    syntax.addFlag(kOffsetBitsFlag, kOffsetBitsFlagLong, MSyntax::kLong);
+    syntax.setObjectType(MSyntax::kStringObjects, 0, 1);
+    return syntax;
+}
+
+// Points a SmearDeformerNode / MotionLinesNode at the given cache
+static MStatus bindNode(const MString& nodeName, const MString& path)
+{
+    MStatus status;
+    MSelectionList list;
+    status = list.add(nodeName);
+    if (!status) {
+        MGlobal::displayError("loadCache: no node named " + nodeName);
+        return status;
+    }
+
+    MObject node;
+    list.getDependNode(0, node);
+    MFnDependencyNode nodeFn(node);
+    MPlug cachePathPlug = nodeFn.findPlug("cachePath", true, &status);
+    if (!status) {
+        MGlobal::displayError("loadCache: " + nodeName + " has no cachePath attribute");
+        return status;
+    }
+    return cachePathPlug.setString(path);
+}
 
 MStatus LoadCacheCmd::doIt(const MArgList& args) {
-    if (args.length() < 1) {
-        MGlobal::displayError("Usage: loadCache <path_to_cache.json>");
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    if (!status) {
+        MGlobal::displayError("Usage: loadCache [-convert] [-node <node>] [-memoryBudget <MB>] "
+            "[-compress <on>] [-tolerance <units>] [-offsetBits <8|16>] <path_to_cache.smc|.json>");
         return MS::kFailure;
     }
 
-    MString path = args.asString(0);
-    bool success = Smear::loadCache(path);
+    if (argData.isFlagSet(kBudgetFlag)) {
+        double budgetMB = 0.0;
+        argData.getFlagArgument(kBudgetFlag, 0, budgetMB);
+        CacheRegistry::setBudget(static_cast<size_t>(std::max(budgetMB, 0.0) * 1024.0 * 1024.0));
+    }
+
+    // Compression settings stick for every cache loaded afterwards
+    CompressionSettings compression = CacheRegistry::compression();
+    if (argData.isFlagSet(kCompressFlag))
+        argData.getFlagArgument(kCompressFlag, 0, compression.enabled);
+    if (argData.isFlagSet(kToleranceFlag)) {
+        argData.getFlagArgument(kToleranceFlag, 0, compression.positionTolerance);
+        compression.positionTolerance = std::max(compression.positionTolerance, 0.0);
+    }
+    if (argData.isFlagSet(kOffsetBitsFlag)) {
+        argData.getFlagArgument(kOffsetBitsFlag, 0, compression.offsetBits);
+        if (compression.offsetBits != 8 && compression.offsetBits != 16) {
+            MGlobal::displayError("loadCache: -offsetBits must be 8 or 16");
+            return MS::kFailure;
+        }
+    }
+    CacheRegistry::setCompression(compression);
+
+    MStringArray objects;
+    argData.getObjects(objects);
+    if (objects.length() == 0)
+        return MS::kSuccess;  // only the budget or compression was changed
+
+    MString path = objects[0];
+    CacheRegistry::Handle cache;
+    const unsigned int nodeCount = argData.numberOfFlagUses(kNodeFlag);
 
-    if (success) {
-        MGlobal::displayInfo("SMEARin: Cache loaded successfully.");
-        MGlobal::displayInfo(MString("[SMEARin] C++ loadCache succeeded; got ")
-            + Smear::vertexCache.size() + " frames.");
-        return MS::kSuccess;
+    if (nodeCount == 0) {
+        if (!Smear::loadCache(path)) {
+            MGlobal::displayError("SMEARin: Failed to load cache.");
+            return MS::kFailure;
+        }
+        cache = Smear::sceneCache();
     }
     else {
-        MGlobal::displayError("SMEARin: Failed to load cache.");
+        // Per-node caches go through the registry only, the scene-wide cache is untouched
+        CacheRegistry::invalidate(path.asChar());
+        std::string error;
+        cache = CacheRegistry::acquire(path.asChar(), error);
+        if (!cache) {
+            MGlobal::displayError(MString("SMEARin: Failed to load cache: ") + error.c_str());
+            return MS::kFailure;
+        }
+
+        for (unsigned int i = 0; i < nodeCount; ++i) {
+            MArgList nodeArgs;
+            argData.getFlagArgumentList(kNodeFlag, i, nodeArgs);
+            status = bindNode(nodeArgs.asString(0), path);
+            if (!status)
+                return status;
+        }
+    }
+
+    MGlobal::displayInfo("SMEARin: Cache loaded successfully.");
+    MGlobal::displayInfo(MString("[SMEARin] C++ loadCache succeeded; got ")
+        + cache->frameCount() + " frames.");
+    if (cache->isCompressed())
+        MGlobal::displayInfo(MString("[SMEARin] Compressed to ") + static_cast<double>(cache->byteSize()) / (1024.0 * 1024.0)
+            + " MB, positions within " + cache->maxPositionError());
+
+    if (argData.isFlagSet(kConvertFlag) && cache->isCompressed()) {
+        MGlobal::displayError("SMEARin: -convert needs the cache uncompressed, load it with -compress false");
         return MS::kFailure;
     }
-}
\ No newline at end of file
+
+    // Write a binary copy of a legacy JSON cache next to it
+    if (argData.isFlagSet(kConvertFlag) && !cache->isMapped()) {
+        MString binaryPath = path;
+        const int extension = path.rindex('.');
+        if (extension > 0)
+            binaryPath = path.substring(0, extension - 1);
+        binaryPath += ".smc";
+
+        if (!Smear::writeBinaryCache(*cache, binaryPath))
+            return MS::kFailure;
+        MGlobal::displayInfo("[SMEARin] Wrote binary cache " + binaryPath);
+    }
+
+    return MS::kSuccess;
+}
@@ -2,9 +2,19 @@
 #include <maya/MPxCommand.h>
 #include <maya/MArgList.h>
 #include <maya/MGlobal.h>
+#include <maya/MSyntax.h>
+
+/*
+	loadCache "path/to/cache.smc";
+	loadCache -convert "path/to/legacy_cache.json";   // also writes path/to/legacy_cache.smc
+	loadCache -node "SmearDeformerNode1" -node "MotionLinesNode1" "path/to/characterA.smc";   // per-node cache
+	loadCache -memoryBudget 2048;   // MB of unused caches kept loaded
+	loadCache -compress true -tolerance 0.001 -offsetBits 8 "path/to/cache.smc";   // keep caches compressed from now on
+*/
 
 class LoadCacheCmd : public MPxCommand {
 public:
     static void* creator() { return new LoadCacheCmd(); }
+    static MSyntax newSyntax();
     MStatus doIt(const MArgList& args) override;
-};
\ No newline at end of file
+};
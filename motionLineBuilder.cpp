@@ -0,0 +1,246 @@
+#include "motionLineBuilder.h"
+#include "cylinder.h"
+#include <algorithm>
+
+namespace {
+    // Direction of the line through point k of polyLine, from its neighbours
+    MVector tangentAt(const MPointArray& polyLine, int pointCount, int k)
+    {
+        const MPoint& before = polyLine[std::max(k - 1, 0)];
+        const MPoint& after = polyLine[std::min(k + 1, pointCount - 1)];
+        return after - before;
+    }
+}
+
+void MotionLineBuilder::resize(int lineCount, int segmentCount, double radius, int slices, MotionLineStyle style)
+{
+    lineCount = std::max(lineCount, 0);
+    segmentCount = std::max(segmentCount, 0);
+    m_radius = radius;
+    m_polyLines.resize(lineCount);
+    const CylinderTemplate& unit = CylinderMesh::unitTemplate(slices);
+    if (lineCount == m_lineCount && segmentCount == m_segmentCount && m_template == &unit && style == m_style)
+        return;
+
+    m_lineCount = lineCount;
+    m_segmentCount = segmentCount;
+    m_template = &unit;
+    m_style = style;
+
+    MIntArray counts, connects;
+    lineTopology(counts, connects);
+    const unsigned int vertices = lineVertexCount();
+
+    m_points.setLength(lineCount * vertices);
+    m_faceCounts.setLength(lineCount * counts.length());
+    m_faceConnects.setLength(lineCount * connects.length());
+
+    // Every line repeats the same faces, offset to its own vertices
+    for (unsigned int line = 0; line < static_cast<unsigned int>(lineCount); ++line) {
+        for (unsigned int i = 0; i < counts.length(); ++i)
+            m_faceCounts[line * counts.length() + i] = counts[i];
+        for (unsigned int i = 0; i < connects.length(); ++i)
+            m_faceConnects[line * connects.length() + i] = connects[i] + static_cast<int>(line * vertices);
+    }
+}
+
+int MotionLineBuilder::slices() const
+{
+    return m_template ? m_template->slices : 0;
+}
+
+unsigned int MotionLineBuilder::lineVertexCount() const
+{
+    const unsigned int segments = static_cast<unsigned int>(m_segmentCount);
+    switch (m_style) {
+    case MotionLineStyle::Tube:
+        return segments == 0 ? 0 : (segments + 1) * m_template->slices;
+    case MotionLineStyle::Ribbon:
+        return segments == 0 ? 0 : (segments + 1) * 2;
+    default:
+        return segments * m_template->points.length();
+    }
+}
+
+void MotionLineBuilder::lineTopology(MIntArray& counts, MIntArray& connects) const
+{
+    if (m_segmentCount == 0)
+        return;
+
+    if (m_style == MotionLineStyle::Cylinders) {
+        const MIntArray& unitCounts = m_template->faceCounts;
+        const MIntArray& unitConnects = m_template->faceConnects;
+        const int vertices = static_cast<int>(m_template->points.length());
+        for (int segment = 0; segment < m_segmentCount; ++segment) {
+            for (unsigned int i = 0; i < unitCounts.length(); ++i)
+                counts.append(unitCounts[i]);
+            for (unsigned int i = 0; i < unitConnects.length(); ++i)
+                connects.append(unitConnects[i] + segment * vertices);
+        }
+        return;
+    }
+
+    if (m_style == MotionLineStyle::Ribbon) {
+        for (int segment = 0; segment < m_segmentCount; ++segment) {
+            counts.append(4);
+            connects.append(segment * 2);
+            connects.append(segment * 2 + 1);
+            connects.append(segment * 2 + 3);
+            connects.append(segment * 2 + 2);
+        }
+        return;
+    }
+
+    // Tube: the template's side quads between consecutive rings, and a cap at either end
+    const int slices = m_template->slices;
+    for (int segment = 0; segment < m_segmentCount; ++segment) {
+        const int ring = segment * slices;
+        for (int i = 0; i < slices; ++i) {
+            counts.append(4);
+            connects.append(ring + i);
+            connects.append(ring + (i + 1) % slices);
+            connects.append(ring + slices + (i + 1) % slices);
+            connects.append(ring + slices + i);
+        }
+    }
+    const int lastRing = m_segmentCount * slices;
+    counts.append(slices);
+    for (int i = slices - 1; i >= 0; --i)
+        connects.append(i);
+    counts.append(slices);
+    for (int i = 0; i < slices; ++i)
+        connects.append(lastRing + i);
+}
+
+void MotionLineBuilder::setLine(int line, const MPointArray& polyLine, const MPoint& anchor)
+{
+    m_polyLines[line] = polyLine;
+    const int pointCount = static_cast<int>(polyLine.length());
+    const MPoint& end = pointCount > 0 ? polyLine[pointCount - 1] : anchor;
+    switch (m_style) {
+    case MotionLineStyle::Tube:
+        setTube(line, polyLine, end);
+        break;
+    case MotionLineStyle::Ribbon:
+        setRibbon(line, polyLine, end);
+        break;
+    default:
+        setCylinders(line, polyLine, end);
+        break;
+    }
+}
+
+void MotionLineBuilder::setCylinders(int line, const MPointArray& polyLine, const MPoint& end)
+{
+    const int pointCount = static_cast<int>(polyLine.length());
+    const unsigned int vertices = m_template->points.length();
+    for (int segment = 0; segment < m_segmentCount; ++segment) {
+        if (segment + 1 < pointCount)
+            setSegment(line, segment, polyLine[segment], polyLine[segment + 1]);
+        else
+            collapse(line * lineVertexCount() + segment * vertices, vertices, end);
+    }
+}
+
+void MotionLineBuilder::setSegment(int line, int segment, const MPoint& start, const MPoint& end)
+{
+    const MPointArray& unit = m_template->points;
+    const unsigned int first = line * lineVertexCount() + segment * unit.length();
+    MVector forward = end - start;
+    const double length = forward.length();
+    if (length < 1e-9) {
+        collapse(first, unit.length(), start);
+        return;
+    }
+    forward /= length;
+
+    MVector left, up;
+    CylinderMesh::basis(forward, left, up);
+
+    // Same placement as CylinderMesh::transform: x runs along the segment, y/z around it
+    for (unsigned int i = 0; i < unit.length(); ++i)
+        setPoint(first + i, start + forward * (unit[i].x * length) + (left * unit[i].y + up * unit[i].z) * m_radius);
+}
+
+void MotionLineBuilder::setTube(int line, const MPointArray& polyLine, const MPoint& end)
+{
+    const int slices = m_template->slices;
+    const int rings = m_segmentCount + 1;
+    const unsigned int first = line * lineVertexCount();
+    const int pointCount = std::min(static_cast<int>(polyLine.length()), rings);
+
+    // Rings are framed by parallel transport, so the tube does not twist between them
+    MVector forward, left, up;
+    bool framed = false;
+    for (int k = 0; k < rings; ++k) {
+        const unsigned int ring = first + k * slices;
+        if (k >= pointCount || pointCount < 2) {
+            collapse(ring, (rings - k) * slices, end);
+            break;
+        }
+        MVector tangent = tangentAt(polyLine, pointCount, k);
+        if (tangent.length() > 1e-9)
+            forward = tangent.normal();
+        else if (!framed) {
+            collapse(ring, slices, polyLine[k]);
+            continue;
+        }
+
+        if (framed) {
+            left -= forward * (left * forward);
+            framed = left.length() > 1e-9;
+        }
+        if (framed) {
+            left.normalize();
+            up = forward ^ left;
+        }
+        else {
+            CylinderMesh::basis(forward, left, up);
+            framed = true;
+        }
+
+        // The template's first ring is the unit circle around x
+        const MPointArray& unit = m_template->points;
+        for (int i = 0; i < slices; ++i)
+            setPoint(ring + i, polyLine[k] + (left * unit[i].y + up * unit[i].z) * m_radius);
+    }
+}
+
+void MotionLineBuilder::setRibbon(int line, const MPointArray& polyLine, const MPoint& end)
+{
+    const int points = m_segmentCount + 1;
+    const unsigned int first = line * lineVertexCount();
+    const int pointCount = std::min(static_cast<int>(polyLine.length()), points);
+
+    MVector side;
+    for (int k = 0; k < points; ++k) {
+        if (k >= pointCount || pointCount < 2) {
+            collapse(first + k * 2, (points - k) * 2, end);
+            break;
+        }
+        // Across the line and the view direction, keeping the last good side when either degenerates
+        const MVector tangent = tangentAt(polyLine, pointCount, k);
+        const MVector across = tangent ^ (polyLine[k] - m_eye);
+        if (across.length() > 1e-9)
+            side = across.normal();
+        else if (side.length() < 1e-9 && tangent.length() > 1e-9) {
+            MVector up;
+            CylinderMesh::basis(tangent.normal(), side, up);
+        }
+        else if (side.length() < 1e-9)
+            side = MVector(0, 1, 0);
+        setPoint(first + k * 2, polyLine[k] - side * m_radius);
+        setPoint(first + k * 2 + 1, polyLine[k] + side * m_radius);
+    }
+}
+
+void MotionLineBuilder::collapse(unsigned int first, unsigned int count, const MPoint& point)
+{
+    for (unsigned int i = 0; i < count; ++i)
+        setPoint(first + i, point);
+}
+
+void MotionLineBuilder::setPoint(unsigned int index, const MPoint& point)
+{
+    m_points[index] = MFloatPoint(static_cast<float>(point.x), static_cast<float>(point.y), static_cast<float>(point.z));
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <maya/MFloatPointArray.h>
+#include <maya/MIntArray.h>
+#include <maya/MPoint.h>
+#include <maya/MPointArray.h>
+#include <maya/MVector.h>
+#include <vector>
+
+struct CylinderTemplate;
+
+/*
+Geometry for motion lines, one per seed and segmentCount segments long.
+
+    Cylinders  a closed, capped cylinder per segment
+    Tube       one swept tube per line, consecutive segments share a ring
+    Ribbon     one camera-facing strip per line, two vertices per point
+
+The buffers are filled in place, so building a frame does no appends. Tube
+rings and cylinders come from the unit template for the slice count, scaled
+by the radius. Face counts and connects only depend on the style and the
+line, segment and slice counts and are rebuilt only when those change; parts
+of a line its polyline does not reach are collapsed onto a point.
+
+The polyline each line was built from is kept for curve output.
+*/
+
+enum class MotionLineStyle { Cylinders, Tube, Ribbon };
+
+class MotionLineBuilder
+{
+public:
+    // Sizes the buffers; topology is only rebuilt when the style or a count changes
+    void resize(int lineCount, int segmentCount, double radius, int slices,
+        MotionLineStyle style = MotionLineStyle::Cylinders);
+    // Ribbons turn their flat side towards eye
+    void setViewPoint(const MPoint& eye) { m_eye = eye; }
+
+    // Sweeps line through polyLine; parts it does not reach collapse onto its last point,
+    // or onto anchor when it is empty
+    void setLine(int line, const MPointArray& polyLine, const MPoint& anchor);
+
+    int lineCount() const { return m_lineCount; }
+    int segmentCount() const { return m_segmentCount; }
+    int slices() const;
+    MotionLineStyle style() const { return m_style; }
+    const MPointArray& polyLine(int line) const { return m_polyLines[line]; }
+    const MFloatPointArray& points() const { return m_points; }
+    const MIntArray& faceCounts() const { return m_faceCounts; }
+    const MIntArray& faceConnects() const { return m_faceConnects; }
+
+private:
+    void setCylinders(int line, const MPointArray& polyLine, const MPoint& end);
+    void setSegment(int line, int segment, const MPoint& start, const MPoint& end);
+    void setTube(int line, const MPointArray& polyLine, const MPoint& end);
+    void setRibbon(int line, const MPointArray& polyLine, const MPoint& end);
+    // Every vertex of the line from vertex first on at point
+    void collapse(unsigned int first, unsigned int count, const MPoint& point);
+    void setPoint(unsigned int index, const MPoint& point);
+
+    // Faces of one line in its own vertex numbering
+    void lineTopology(MIntArray& counts, MIntArray& connects) const;
+    unsigned int lineVertexCount() const;
+
+    int m_lineCount = 0;
+    int m_segmentCount = 0;
+    double m_radius = 0.0;
+    MotionLineStyle m_style = MotionLineStyle::Cylinders;
+    const CylinderTemplate* m_template = nullptr;
+    MPoint m_eye;
+
+    std::vector<MPointArray> m_polyLines;
+    MFloatPointArray m_points;
+    MIntArray m_faceCounts;
+    MIntArray m_faceConnects;
+};
@@ -1,13 +1,18 @@
 #include "motionLinesNode.h"
 #include "smear.h"
 #include "cylinder.h"    // Needed for CylinderMesh
-#include <numeric>
+#include "catmullRom.h"
+#include "seedSelection.h"
 #include <algorithm>
-#include <random>
 #include <maya/MFnUnitAttribute.h>
 #include <maya/MFnTypedAttribute.h>
 #include <maya/MFnNumericAttribute.h>
 #include <maya/MFnMessageAttribute.h>
+#include <maya/MFnEnumAttribute.h>
+#include <maya/MFnNurbsCurve.h>
+#include <maya/MFnNurbsCurveData.h>
+#include <maya/MArrayDataHandle.h>
+#include <maya/MArrayDataBuilder.h>
 #include <maya/MFnMesh.h>
 #include <maya/MFnMeshData.h>
 #include <maya/MPointArray.h>
@@ -18,6 +23,10 @@
 #include <maya/MTime.h>
 #include <maya/MGlobal.h>
 #include <maya/MDagPath.h> 
+#include <maya/MAnimControl.h>
+#include <maya/MMessage.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
 #define McheckErr(stat, msg)        \
     if (MS::kSuccess != stat) {     \
@@ -32,6 +41,7 @@ MTypeId MotionLinesNode::id(0x98534); // Random id
 MObject MotionLinesNode::time;
 MObject MotionLinesNode::aInputMesh;
 MObject MotionLinesNode::aOutputMesh;
+MObject MotionLinesNode::aOutputCurves;
 MObject MotionLinesNode::smoothWindowSize;
 MObject MotionLinesNode::smoothEnabled;
 MObject MotionLinesNode::aStrengthPast;
@@ -40,50 +50,58 @@ MObject MotionLinesNode::aMotionLineSegments;
 MObject MotionLinesNode::aGenerateMotionLines;
 MObject MotionLinesNode::aMotionLinesCount; 
 MObject MotionLinesNode::aRadius;
+MObject MotionLinesNode::aSlices;
+MObject MotionLinesNode::aLevelOfDetail;
+MObject MotionLinesNode::aLodCameraPosition;
+MObject MotionLinesNode::aStyle;
 MObject MotionLinesNode::inputControlMsg;  // Message attribute for connecting to the control node
 MObject MotionLinesNode::aCacheLoaded;
+MObject MotionLinesNode::aCachePath;
+StatsAttributes MotionLinesNode::statsAttributes;
 
-MStatus MotionLinesNode::selectSeeds(int count)
-{
-    seedIndices.clear();
-
-    // Retrieve the input mesh from the nodes attribute.
-    MPlug meshPlug(thisMObject(), aInputMesh);
-    MObject meshObj = meshPlug.asMObject();
-    if (meshObj.isNull()) {
-        MGlobal::displayError("Input mesh is null. Cannot select seed vertices.");
-            return MS::kFailure;
-    }
-
-    // Use MFnMesh to get vertex positions in world space.
-    MFnMesh meshFn(meshObj);
-    MPointArray allVerts;
-    MStatus status = meshFn.getPoints(allVerts, MSpace::kWorld);
-    if (!status) {
-        MGlobal::displayError("Failed to retrieve points from the input mesh.");
-            return status;
-    }
+// Motion lines per parallel task; a line is a few spline samples and its mesh, so keep chunks small
+static const int kLineGrainSize = 4;
 
-    const int totalVerts = static_cast<int>(allVerts.length());
-    if (totalVerts == 0) {
-        MGlobal::displayError("Mesh has no vertices to select from.");
-            return MS::kFailure;
-    }
-
-    // Cap the count to the number of available vertices
-    int numToSelect = std::min(count, totalVerts);
-
-    // Generate a list of all indices and shuffle it
-    std::vector<int> indices(totalVerts);
-    std::iota(indices.begin(), indices.end(), 0);
-    std::shuffle(indices.begin(), indices.end(), std::default_random_engine(12345));
+void MotionLinesNode::selectSeeds(const FrameStore& frames, int count)
+{
+    if (count == cachedMotionLinesCount && frames.vertexCount() == seededVertexCount)
+        return;
+
+    const std::vector<int> seeds = selectMotionLineSeeds(frames, count);
+    seedIndices.setLength(static_cast<unsigned int>(seeds.size()));
+    for (unsigned int i = 0; i < seedIndices.length(); ++i)
+        seedIndices[i] = seeds[i];
+    cachedMotionLinesCount = count;
+    seededVertexCount = frames.vertexCount();
+}
 
-    // Take the first 'numToSelect' unique indices
-    for (int i = 0; i < numToSelect; ++i) {
-        seedIndices.append(indices[i]);
+int MotionLinesNode::lineSlices(MDataBlock& data, const FrameStore& frames, int frame, double radius) const
+{
+    const int slices = data.inputValue(aSlices).asInt();
+    if (!data.inputValue(aLevelOfDetail).asBool())
+        return slices;
+
+    // One slice count for the whole mesh, so the nearest line decides it
+    const MVector& camera = data.inputValue(aLodCameraPosition).asVector();
+    const MPoint eye(camera.x, camera.y, camera.z);
+    double nearest = -1.0;
+    for (unsigned int s = 0; s < seedIndices.length(); s++) {
+        const double distance = Smear::toPoint(frames.position(frame, seedIndices[s])).distanceTo(eye);
+        if (nearest < 0.0 || distance < nearest)
+            nearest = distance;
     }
+    return CylinderMesh::lodSlices(radius, std::max(nearest, 0.0), slices);
+}
 
-    return MS::kSuccess;
+void MotionLinesNode::resizeLines(MDataBlock& data, const FrameStore& frames, int frame, int segmentCount)
+{
+    const double radius = data.inputValue(aRadius).asDouble();
+    const MotionLineStyle style = static_cast<MotionLineStyle>(data.inputValue(aStyle).asShort());
+    // Ribbons have no slices to drop, skip looking for the nearest line
+    const int slices = style == MotionLineStyle::Ribbon ? CylinderMesh::kMinSlices : lineSlices(data, frames, frame, radius);
+    const MVector& eye = data.inputValue(aLodCameraPosition).asVector();
+    lineBuilder.setViewPoint(MPoint(eye.x, eye.y, eye.z));
+    lineBuilder.resize(static_cast<int>(seedIndices.length()), segmentCount, radius, slices, style);
 }
 
 
@@ -92,9 +110,50 @@ MStatus MotionLinesNode::selectSeeds(int count)
 // Constructors and Creator Function
 //-----------------------------------------------------------------
 MotionLinesNode::MotionLinesNode():
-    motionOffsetsSimple(), motionOffsetsBaked(false), cachedMotionLinesCount(0) 
+    motionOffsetsSimple(), inputResolved(false), inputArticulated(false), inputCallback(0), cachedMotionLinesCount(-1), seededVertexCount(0) 
 {}
-MotionLinesNode::~MotionLinesNode() {}
+MotionLinesNode::~MotionLinesNode()
+{
+    if (inputCallback != 0)
+        MMessage::removeCallback(inputCallback);
+}
+
+void MotionLinesNode::postConstructor()
+{
+    MStatus status;
+    MObject node = thisMObject();
+    MCallbackId id = MNodeMessage::addAttributeChangedCallback(node, inputConnectionChanged, this, &status);
+    if (status)
+        inputCallback = id;
+    else
+        MGlobal::displayWarning("MotionLinesNode: could not watch input connections, a reconnected mesh will not be picked up");
+}
+
+void MotionLinesNode::inputConnectionChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData)
+{
+    if ((msg & (MNodeMessage::kConnectionMade | MNodeMessage::kConnectionBroken)) && plug.attribute() == aInputMesh)
+        PreparedNode::request(static_cast<MotionLinesNode*>(clientData)->thisMObject());
+}
+
+MStatus MotionLinesNode::prepare()
+{
+    MStatus status;
+    MObject node = thisMObject();
+    inputResolved = false;
+    status = Smear::getDagPathsFromInputMesh(MObject::kNullObj, MPlug(node, aInputMesh), inputTransformPath, inputShapePath);
+    McheckErr(status, "Failed to transform path and shape path from input object");
+    inputArticulated = skinBinding.isArticulated(inputShapePath, node);
+    inputResolved = true;
+    if (inputArticulated)
+        return MS::kSuccess;
+
+    // Baked once; afterwards key edits only re-bake the frames they touched
+    int firstChanged, lastChanged;
+    status = Smear::updateMotionOffsetsSimple(inputShapePath, inputTransformPath, node, motionOffsetsSimple, firstChanged, lastChanged);
+    McheckErr(status, "Failed to compute motion offsets");
+    motionOffsetsSimple.markChanged(firstChanged, lastChanged);
+    return MS::kSuccess;
+}
 
 void* MotionLinesNode::creator() {
     return new MotionLinesNode;
@@ -109,11 +168,17 @@ MStatus MotionLinesNode::initialize() {
     MFnTypedAttribute   tAttr;
     MFnNumericAttribute nAttr;
     MFnMessageAttribute mAttr;
+    MFnEnumAttribute    eAttr;
 
     aCacheLoaded = nAttr.create("cacheLoaded", "cl", MFnNumericData::kBoolean, false, &status);
     CHECK_MSTATUS_AND_RETURN_IT(status);
     addAttribute(aCacheLoaded);
 
+    // Cache this node samples; empty uses the scene-wide cache from loadCache
+    aCachePath = tAttr.create("cachePath", "cp", MFnData::kString, MObject::kNullObj, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    addAttribute(aCachePath);
+
     // Time attribute
     time = uAttr.create("time", "tm", MFnUnitAttribute::kTime, 0.0, &status);
     CHECK_MSTATUS_AND_RETURN_IT(status);
@@ -130,6 +195,15 @@ MStatus MotionLinesNode::initialize() {
     CHECK_MSTATUS_AND_RETURN_IT(status);
     addAttribute(aOutputMesh);
 
+    // One curve per motion line, for renderers with curve primitives
+    aOutputCurves = tAttr.create("outputCurves", "ocrv", MFnData::kNurbsCurve, MObject::kNullObj, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    tAttr.setArray(true);
+    tAttr.setUsesArrayDataBuilder(true);
+    tAttr.setStorable(false);
+    tAttr.setWritable(false);
+    addAttribute(aOutputCurves);
+
 
     // Smooth enabled attribute
     smoothEnabled = nAttr.create("smoothEnabled", "smenb", MFnNumericData::kBoolean, true, &status);
@@ -191,6 +265,37 @@ MStatus MotionLinesNode::initialize() {
     nAttr.setMax(1.0);
     addAttribute(aRadius);
 
+    // Cylinder slices around a motion line, the most level of detail will use
+    aSlices = nAttr.create("motionLinesSlices", "mlsl", MFnNumericData::kInt, CylinderMesh::kDefaultSlices, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    nAttr.setStorable(false);
+    nAttr.setKeyable(false);
+    nAttr.setMin(CylinderMesh::kMinSlices);
+    nAttr.setMax(CylinderMesh::kMaxSlices);
+    addAttribute(aSlices);
+
+    // Drops slices on thin motion lines and on lines far from the camera position
+    aLevelOfDetail = nAttr.create("motionLinesLod", "mllod", MFnNumericData::kBoolean, false, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    nAttr.setKeyable(false);
+    addAttribute(aLevelOfDetail);
+
+    // World position level of detail measures distance from and ribbons face, e.g. the render
+    // camera's translate
+    aLodCameraPosition = nAttr.createPoint("lodCameraPosition", "lcp", &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    nAttr.setKeyable(false);
+    addAttribute(aLodCameraPosition);
+
+    // Geometry of the output mesh: capped cylinders per segment, a tube or a ribbon per line
+    aStyle = eAttr.create("motionLinesStyle", "mlst", 0, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    eAttr.addField("Cylinders", static_cast<short>(MotionLineStyle::Cylinders));
+    eAttr.addField("Tube", static_cast<short>(MotionLineStyle::Tube));
+    eAttr.addField("Ribbon", static_cast<short>(MotionLineStyle::Ribbon));
+    eAttr.setKeyable(false);
+    addAttribute(aStyle);
+
     // Message attribute for connecting this node to the control node.
     inputControlMsg = mAttr.create("inputControlMessage", "icm", &status);
     CHECK_MSTATUS_AND_RETURN_IT(status);
@@ -198,6 +303,10 @@ MStatus MotionLinesNode::initialize() {
     mAttr.setKeyable(false);
     addAttribute(inputControlMsg);
 
+    // Read-only profiling outputs, updated after every compute
+    status = statsAttributes.add();
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
     attributeAffects(aInputMesh, aOutputMesh);
     attributeAffects(time, aOutputMesh);
     attributeAffects(smoothEnabled, aOutputMesh);
@@ -208,8 +317,27 @@ MStatus MotionLinesNode::initialize() {
     attributeAffects(aGenerateMotionLines, aOutputMesh);
     attributeAffects(aMotionLinesCount, aOutputMesh);
     attributeAffects(aRadius, aOutputMesh);
+    attributeAffects(aSlices, aOutputMesh);
+    attributeAffects(aLevelOfDetail, aOutputMesh);
+    attributeAffects(aLodCameraPosition, aOutputMesh);
+    attributeAffects(aStyle, aOutputMesh);
     attributeAffects(inputControlMsg, aOutputMesh);
     attributeAffects(aCacheLoaded, aOutputMesh);
+    attributeAffects(aCachePath, aOutputMesh);
+
+    // Curves follow the line points only, not their thickness or style
+    attributeAffects(aInputMesh, aOutputCurves);
+    attributeAffects(time, aOutputCurves);
+    attributeAffects(smoothEnabled, aOutputCurves);
+    attributeAffects(smoothWindowSize, aOutputCurves);
+    attributeAffects(aStrengthPast, aOutputCurves);
+    attributeAffects(aStrengthFuture, aOutputCurves);
+    attributeAffects(aMotionLineSegments, aOutputCurves); 
+    attributeAffects(aGenerateMotionLines, aOutputCurves);
+    attributeAffects(aMotionLinesCount, aOutputCurves);
+    attributeAffects(inputControlMsg, aOutputCurves);
+    attributeAffects(aCacheLoaded, aOutputCurves);
+    attributeAffects(aCachePath, aOutputCurves);
 
     return MS::kSuccess;
 }
@@ -228,8 +356,8 @@ MStatus MotionLinesNode::setMotionLinesNone(const MPlug& plug, MDataBlock& data)
     MDataHandle outputHandle = data.outputValue(aOutputMesh, &status);
     CHECK_MSTATUS_AND_RETURN_IT(status);
     outputHandle.set(newOutput);
-    data.setClean(plug);
-    return status; 
+    data.setClean(aOutputMesh);
+    return setOutputCurves(data, 0);
 }
 
 MObject MotionLinesNode::createMesh(const MTime& time,
@@ -280,14 +408,77 @@ MObject MotionLinesNode::createMesh(const MTime& time,
 }
 
 
-MStatus MotionLinesNode::appendCylinder(MPoint start, MPoint end, double radius, 
-    MPointArray& points, MIntArray& faceCounts, MIntArray& faceConnects)
+// Hands the builder's geometry to the output. While the cylinder count is unchanged the mesh
+// already there keeps its topology and only gets new points
+MStatus MotionLinesNode::setOutputLines(const MPlug& plug, MDataBlock& data)
 {
-    // Create a cylinder between the two points
-    CylinderMesh cylinder(start, end, radius);
-    // Append cylinder geometry to the main mesh arrays.
-    cylinder.appendToMesh(points, faceCounts, faceConnects);
+    const MFloatPointArray& points = lineBuilder.points();
+    if (points.length() == 0)
+        return setMotionLinesNone(plug, data);
+
+    MStatus status;
+    MDataHandle outputHandle = data.outputValue(aOutputMesh, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
 
+    MObject outputObj = outputHandle.asMesh();
+    if (!outputObj.isNull() && outputObj.hasFn(MFn::kMesh)) {
+        MFnMesh outputFn(outputObj);
+        if (outputFn.numVertices() == static_cast<int>(points.length()) &&
+            outputFn.numPolygons() == static_cast<int>(lineBuilder.faceCounts().length())) {
+            status = outputFn.setPoints(points);
+            CHECK_MSTATUS_AND_RETURN_IT(status);
+            data.setClean(aOutputMesh);
+            return setOutputCurves(data, lineBuilder.lineCount());
+        }
+    }
+
+    MFnMeshData meshData;
+    MObject newOutput = meshData.create(&status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    MFnMesh meshFn;
+    meshFn.create(points.length(), lineBuilder.faceCounts().length(),
+        points, lineBuilder.faceCounts(), lineBuilder.faceConnects(), newOutput, &status);
+    if (status != MS::kSuccess) {
+        MGlobal::displayError("Motion lines mesh creation failed.");
+        return status;
+    }
+
+    outputHandle.set(newOutput);
+    data.setClean(aOutputMesh);
+    return setOutputCurves(data, lineBuilder.lineCount());
+}
+
+MStatus MotionLinesNode::setOutputCurves(MDataBlock& data, int lineCount)
+{
+    MStatus status;
+    MArrayDataHandle outputArray = data.outputArrayValue(aOutputCurves, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    MArrayDataBuilder builder(&data, aOutputCurves, lineCount, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
+    MFnNurbsCurve curveFn;
+    for (int line = 0; line < lineCount; line++) {
+        MDataHandle element = builder.addElement(line, &status);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+        MFnNurbsCurveData curveData;
+        MObject curveObj = curveData.create(&status);
+        CHECK_MSTATUS_AND_RETURN_IT(status);
+
+        // Lines that did not reach a second point are left as empty curve data
+        const MPointArray& polyLine = lineBuilder.polyLine(line);
+        if (polyLine.length() >= 2) {
+            const unsigned int degree = polyLine.length() > 2 ? 3 : 1;
+            curveFn.createWithEditPoints(polyLine, degree, MFnNurbsCurve::kOpen, false, false, false, curveObj, &status);
+            CHECK_MSTATUS_AND_RETURN_IT(status);
+        }
+        element.set(curveObj);
+    }
+
+    status = outputArray.set(builder);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    outputArray.setAllClean();
+    data.setClean(aOutputCurves);
     return MS::kSuccess;
 }
 
@@ -389,6 +580,21 @@ MObject MotionLinesNode::createReverseTris(const MFloatPointArray& points, MObje
 }
 
 MStatus MotionLinesNode::compute(const MPlug& plug, MDataBlock& data) {
+    // Both outputs are written by every evaluation
+    const bool curvesPlug = plug == aOutputCurves || (plug.isElement() && plug.array() == aOutputCurves);
+    if (plug != aOutputMesh && !curvesPlug) return MS::kUnknownParameter;
+
+    MStatus status;
+    {
+        SmearProfilingScope scope("Compute", m_stats.evaluateMs, MProfiler::kColorE_L2);
+        status = computeMotionLines(plug, data);
+    }
+    ++m_stats.evaluations;
+    statsAttributes.write(data, m_stats);
+    return status;
+}
+
+MStatus MotionLinesNode::computeMotionLines(const MPlug& plug, MDataBlock& data) {
     MStatus status;
 
     MDataHandle genHandle = data.inputValue(aGenerateMotionLines, &status);
@@ -411,20 +617,20 @@ MStatus MotionLinesNode::compute(const MPlug& plug, MDataBlock& data) {
         return MS::kFailure;
     }
 
-    // Get DAG paths for mesh and transform
-    MFnDependencyNode thisNodeFn(thisMObject());
-    MPlug inputPlug = thisNodeFn.findPlug(aInputMesh, true);
-
-    MDagPath shapePath, transformPath;
-    status = Smear::getDagPathsFromInputMesh(inputObj, inputPlug, transformPath, shapePath);
-    McheckErr(status, "Failed to transform path and shape path from input object");
+    // The mesh and whether it is skinned were resolved by prepare(); nothing to draw before that
+    if (!hasPrepared())
+        prepareOrRequest(thisMObject());
+    if (!inputResolved)
+        return MS::kSuccess;
+    MDagPath shapePath = inputShapePath;
+    MDagPath transformPath = inputTransformPath;
 
     // +++ Get time value +++
     MTime currentTime = data.inputValue(time, &status).asTime();
     McheckErr(status, "Failed to get time value");
-    double frame = currentTime.as(MTime::kFilm);  // Get time in frames
+    double frame = currentTime.as(MTime::uiUnit());  // Scene frame, which indexes the simple-object bake
 
-    if (Smear::isMeshArticulated(shapePath)) {
+    if (inputArticulated) {
         MDataHandle cacheLoadedHandle = data.inputValue(aCacheLoaded, &status);
         bool cacheLoaded = cacheLoadedHandle.asBool();
 
@@ -433,152 +639,123 @@ MStatus MotionLinesNode::compute(const MPlug& plug, MDataBlock& data) {
             return MS::kSuccess; 
         }
 
-        // Maya seems to always evaluate deformer node at 24 fps, 
-        // So if the viewport is set to 30 fps,
-        // and the viewport's current frame is 30 
-        // frameD will be 24. (frame 30 / 30 fps = 1 sec; 1 sec * 24 fps = frame 24)
-        const double deformerEvaluationFPS = 24.0;
-        double sampleFrameD = frame * Smear::cacheFPS / deformerEvaluationFPS;
-        int sampleFrame = static_cast<int>(sampleFrameD);
-
-        // assume Smear::vertexCache[f] corresponds to Maya frame f <- NOT TRUE ANYMORE SINCE WE ARE USING VECTOR INSTEAD OF MAP 
-        if (Smear::vertexCache.find(sampleFrame) == Smear::vertexCache.end())
+        CacheRegistry::Handle resolved = Smear::resolveCache(data.inputValue(aCachePath).asString());
+        if (!resolved)
+            return MS::kFailure;
+        bool cacheHit = resolved == boundCache;
+        boundCache = resolved;
+        const FrameStore& source = *boundCache;
+        // The cache is at the scene rate, so the scene frame indexes it
+        const double sampleFrameD = Smear::cacheFrame(currentTime, source);
+        const int sampleFrameNumber = static_cast<int>(std::floor(sampleFrameD));
+        int sampleFrame = source.frameIndex(sampleFrameNumber);
+
+        if (!source.hasFrame(sampleFrame))
             return MS::kFailure;
-
-        const FrameCache& fc = Smear::vertexCache[sampleFrame];
-        const MDoubleArray& offsets = fc.motionOffsets; 
-        const int numFrames = Smear::vertexCache.size(); 
-
-        // Compute smoothed offsets, etc.
-        const bool smoothingEnabled = data.inputValue(smoothEnabled).asBool();
-        const int N = smoothingEnabled ? data.inputValue(smoothWindowSize).asInt() : 0;
-        std::vector<double> smoothedOffsets(offsets.length(), 0.0);
-        for (int vertIdx = 0; vertIdx < offsets.length(); ++vertIdx) {
-            double totalWeight = 0.0;
-            double smoothed = 0.0;
-            for (int n = -N; n <= N; ++n) {
-                const int frame = sampleFrame + n;
-                if (Smear::vertexCache.find(frame) == Smear::vertexCache.end()) {
-                    continue;
-                }
-                const double normalized = std::abs(n) / static_cast<double>(N + 1);
-                const double weight = std::pow(1.0 - std::pow(normalized, 2.0), 2.0);
-
-                if (Smear::vertexCache.find(sampleFrame) == Smear::vertexCache.end())
-                    continue; 
-
-                smoothed += Smear::vertexCache[frame].motionOffsets[vertIdx] * weight;
-                totalWeight += weight;
-            }
-            smoothedOffsets[vertIdx] = totalWeight > 0.0 ? smoothed / totalWeight : offsets[vertIdx];
-        }
-
-        MPointArray mlPoints;
-        MIntArray mlFaceCounts;
-        MIntArray mlFaceConnects;
 
         // Artistic control param
         const double strengthPast = data.inputValue(aStrengthPast).asDouble();
         const double strengthFuture = data.inputValue(aStrengthFuture).asDouble();
-        const double cylinderRadius = data.inputValue(aRadius).asDouble();
         const int segmentCount = data.inputValue(aMotionLineSegments).asInt();
+        const bool smoothingEnabled = data.inputValue(smoothEnabled).asBool();
+        const int N = smoothingEnabled ? data.inputValue(smoothWindowSize).asInt() : 0;
 
-        int motionLinesCount = data.inputValue(aMotionLinesCount).asInt();
-        if (cachedMotionLinesCount != motionLinesCount) {
-            selectSeeds(motionLinesCount);
-            cachedMotionLinesCount = motionLinesCount;
+        // Lines reach up to the strength away from sampleFrame, plus the spline's neighbours
+        const int reach = static_cast<int>(std::ceil(std::max(strengthPast, strengthFuture))) + 2;
+        if (MAnimControl::isPlaying())
+            prefetcher.request(boundCache, sampleFrame, reach + N);
+        else
+            prefetcher.reset();
+
+        // Compressed caches are sampled from the frames decoded around sampleFrame, with room
+        // for the smoothing window; smoothing then only covers those frames
+        bool decoded = false;
+        const FrameStore& cache = cacheWindow.view(boundCache, sampleFrame - reach - N, sampleFrame + reach + N, &decoded);
+        sampleFrame = cache.frameIndex(sampleFrameNumber);
+        if (decoded)
+            smoothedOffsetCache.invalidate();
+
+        // Smoothed offsets for the whole clip are built once per window, this frame is a lookup
+        {
+            SmearProfilingScope scope("Smooth offsets", m_stats.smoothMs);
+            cacheHit &= !smoothedOffsetCache.update(cache, N);
         }
-
-        for (unsigned int s = 0; s < seedIndices.length(); s++) {
-            int vertexIndex = seedIndices[s]; 
-
-            // Get the smoothed offset for this vertex.
-            double offset = smoothedOffsets[vertexIndex];
-
-            // Determine sampling direction:
-            // +1 for positive (leading) offsets, -1 for negative (trailing) offsets.
-            int direction = (offset >= 0.0) ? 1 : -1;
-
-            // Determine the appropriate motion line strength factor.
-            // These are assumed to be parameters from your node.
-            double strengthFactor = (offset >= 0.0) ? strengthFuture : strengthPast;
-
-            // Build a polyline along the vertex's trajectory.
-            // Instead of sampling consecutive frames, multiply the segment index by the strength factor.
+        m_stats.countLookup(cacheHit);
+        m_stats.residentBytes = source.residentBytes() + smoothedOffsetCache.residentBytes();
+        if (&cache != &source)
+            m_stats.residentBytes += cache.residentBytes();
+        const float* smoothedOffsets = smoothedOffsetCache.offsets(sampleFrame);
+
+        selectSeeds(cache, data.inputValue(aMotionLinesCount).asInt());
+        resizeLines(data, cache, sampleFrame, segmentCount);
+
+        {
+            // Lines only write their own part of the builder's buffers, so they are built in parallel
+            SmearProfilingScope scope("Sample motion lines", m_stats.interpolateMs);
+            const int lineCount = static_cast<int>(seedIndices.length());
+            tbb::parallel_for(tbb::blocked_range<int>(0, lineCount, kLineGrainSize),
+                [&](const tbb::blocked_range<int>& range) {
+            // Per-line sample buffers for the batched spline evaluation, reused across the chunk
+            std::vector<int> sampleVertices, baseFrames;
+            std::vector<float> sampleT, sampled;
             MPointArray polyLine;
-            for (int seg = 0; seg <= segmentCount; seg++) {
-                double totalLength = strengthFactor; // treat strength as total motion line length in frames
-                double frameInterval = totalLength / static_cast<double>(segmentCount);
-                double sampleOffset = seg * frameInterval * direction;
-                double sampleFrameD = sampleFrame + sampleOffset;
-
-                // Integer and fractional components
-                int f1 = static_cast<int>(floor(sampleFrameD));
-                float t = static_cast<float>(sampleFrameD - f1);
-
-                // Need f0, f1, f2, f3 for Catmull-Rom
-                int f0 = f1 - 1;
-                int f2 = f1 + 1;
-                int f3 = f1 + 2;
-
-                // Validate bounds
-                if (Smear::vertexCache.find(f0) == Smear::vertexCache.end() ||
-                    Smear::vertexCache.find(f1) == Smear::vertexCache.end() ||
-                    Smear::vertexCache.find(f2) == Smear::vertexCache.end() ||
-                    Smear::vertexCache.find(f3) == Smear::vertexCache.end())
-                {
-                    continue; // Or break;
+            for (int s = range.begin(); s != range.end(); s++) {
+                int vertexIndex = seedIndices[s]; 
+
+                // Get the smoothed offset for this vertex.
+                double offset = smoothedOffsets[vertexIndex];
+
+                // Determine sampling direction:
+                // +1 for positive (leading) offsets, -1 for negative (trailing) offsets.
+                int direction = (offset >= 0.0) ? 1 : -1;
+
+                // Determine the appropriate motion line strength factor.
+                // These are assumed to be parameters from your node.
+                double strengthFactor = (offset >= 0.0) ? strengthFuture : strengthPast;
+
+                // Build a polyline along the vertex's trajectory.
+                // Instead of sampling consecutive frames, multiply the segment index by the strength factor.
+                sampleVertices.clear();
+                baseFrames.clear();
+                sampleT.clear();
+                for (int seg = 0; seg <= segmentCount; seg++) {
+                    double totalLength = strengthFactor; // treat strength as total motion line length in frames
+                    double frameInterval = totalLength / static_cast<double>(segmentCount);
+                    double sampleOffset = seg * frameInterval * direction;
+                    double sampleFrameD = sampleFrame + sampleOffset;
+
+                    // Integer and fractional components
+                    int f1 = static_cast<int>(floor(sampleFrameD));
+                    float t = static_cast<float>(sampleFrameD - f1);
+
+                    // Need f0, f1, f2, f3 for Catmull-Rom, all inside the cache
+                    if (!cache.hasFrame(f1 - 1) || !cache.hasFrame(f1 + 2)) {
+                        continue; // Or break;
+                    }
+
+                    sampleVertices.push_back(vertexIndex);
+                    baseFrames.push_back(f1);
+                    sampleT.push_back(t);
                 }
 
-                const MPoint& p0 = Smear::vertexCache[f0].positions[vertexIndex];
-                const MPoint& p1 = Smear::vertexCache[f1].positions[vertexIndex];
-                const MPoint& p2 = Smear::vertexCache[f2].positions[vertexIndex];
-                const MPoint& p3 = Smear::vertexCache[f3].positions[vertexIndex];
-
-                MPoint interpolated = Smear::catmullRomInterpolate(p0, p1, p2, p3, t);
-                polyLine.append(interpolated);
-            }
+                const int sampleCount = static_cast<int>(sampleT.size());
+                sampled.resize(sampleCount * 3);
+                sampleTrajectories(cache, sampleVertices.data(), baseFrames.data(), sampleT.data(), sampleCount, sampled.data());
 
-            // Create cylinder segments between consecutive polyline points.
-            for (unsigned int j = 0; j + 1 < polyLine.length(); j++) {
-                status = appendCylinder(polyLine[j], polyLine[j + 1], cylinderRadius, 
-                    mlPoints, mlFaceCounts, mlFaceConnects);
-                if (status != MS::kSuccess) {
-                    MGlobal::displayError("Failed to append cylinder for motion line segment.");
-                    return status;
+                polyLine.setLength(sampleCount);
+                for (int k = 0; k < sampleCount; k++) {
+                    polyLine[k] = Smear::toPoint(&sampled[k * 3]);
                 }
-            }
-        }
-
-        // Create new mesh data container
-        MFnMeshData meshData;
-        MObject newOutput = meshData.create(&status);
-
-        // Copy mesh using API method
-        MFnMesh inputFn(inputObj);
-        MObject copiedMesh = inputFn.copy(inputObj, newOutput, &status);
-        McheckErr(status, "Mesh copy failed");
 
-        // Cast copied Mesh into MFnMesh
-        MFnMesh outputFn(copiedMesh, &status);
-        McheckErr(status, "Output mesh init failed");
-
-
-        //MGlobal::displayInfo(MString() + "mlPoints.length(): " + mlPoints.length() + "mlFaceCounts.length(): " + mlFaceCounts.length());
-        MFnMesh meshFn;
-        MObject motionLinesMesh = meshFn.create(mlPoints.length(), mlFaceCounts.length(),
-            mlPoints, mlFaceCounts, mlFaceConnects, newOutput, &status);
-        if (status != MS::kSuccess) {
-            MGlobal::displayError("Motion lines mesh creation failed.");
-            return status;
+                // Create cylinder segments between consecutive polyline points.
+                lineBuilder.setLine(s, polyLine, Smear::toPoint(cache.position(sampleFrame, vertexIndex)));
+            }
+            });
         }
 
-        MDataHandle outputHandle = data.outputValue(aOutputMesh, &status);
-        CHECK_MSTATUS_AND_RETURN_IT(status);
-        outputHandle.set(newOutput);
-        data.setClean(plug);
-
-        return MS::kSuccess;
+        m_stats.verticesProcessed = lineBuilder.points().length();
+        SmearProfilingScope scope("Create motion lines mesh", m_stats.meshMs);
+        return setOutputLines(plug, data);
     }
     else {
         return computeSimple(status, inputObj, data, shapePath, transformPath, frame, plug);
@@ -587,127 +764,92 @@ MStatus MotionLinesNode::compute(const MPlug& plug, MDataBlock& data) {
 
 const MStatus& MotionLinesNode::computeSimple(MStatus& status, MObject& inputObj, MDataBlock& data, MDagPath& shapePath, MDagPath& transformPath, double frame, const MPlug& plug)
 {
-    // Create new mesh data container
-    MFnMeshData meshData;
-    MObject newOutput = meshData.create(&status);
-    McheckErr(status, "Failed to create output mesh container");
+    MFnMesh inputFn(inputObj, &status);
+    McheckErr(status, "Input mesh init failed");
 
-    // Copy mesh using API method
-    MFnMesh inputFn(inputObj);
-    MObject copiedMesh = inputFn.copy(inputObj, newOutput, &status);
-    McheckErr(status, "Mesh copy failed");
-
-    // Cast copied Mesh into MFnMesh
-    MFnMesh outputFn(copiedMesh, &status);
-    McheckErr(status, "Output mesh init failed");
-
-    const int numVertices = outputFn.numVertices();
+    const int numVertices = inputFn.numVertices();
     if (numVertices == 0) {
         MGlobal::displayError("Mesh has no vertices");
         return MS::kFailure;
     }
 
-    int motionLinesCount = data.inputValue(aMotionLinesCount).asInt();
-    if (cachedMotionLinesCount != motionLinesCount) {
-        selectSeeds(motionLinesCount);
-        cachedMotionLinesCount = motionLinesCount;
-    }
-
-    // +++ Compute motion offsets using Smear functions +++
-    if (!motionOffsetsBaked) {
-        status = Smear::computeMotionOffsetsSimple(shapePath, transformPath, motionOffsetsSimple);
-
-        McheckErr(status, "Failed to compute motion offsets");
-        motionOffsetsBaked = true;
+    // Motion offsets are baked by prepare(); a bake in another time unit needs another one
+    const FrameStore& frames = motionOffsetsSimple.frames;
+    if (!frames.empty() && std::abs(frames.fps() - Smear::sceneFps()) > 1e-6)
+        prepareOrRequest(thisMObject());
+    if (frames.empty())
+        return MS::kSuccess;
+    // Frames prepare() baked again since the last evaluation
+    int firstChanged, lastChanged;
+    motionOffsetsSimple.takeChanged(firstChanged, lastChanged);
+    m_stats.bakeMs = motionOffsetsSimple.bakeMs;
+    bool rebuilt = firstChanged <= lastChanged;
+
+    {
+        // Smoothed offsets for the whole clip are built once per window, each frame is a lookup
+        SmearProfilingScope scope("Smooth offsets", m_stats.smoothMs);
+        const bool smoothingEnabled = data.inputValue(smoothEnabled).asBool();
+        const int N = smoothingEnabled ? data.inputValue(smoothWindowSize).asInt() : 0;
+        rebuilt |= smoothedOffsetCache.refresh(frames, firstChanged, lastChanged);
+        rebuilt |= smoothedOffsetCache.update(frames, N);
     }
+    m_stats.countLookup(!rebuilt);
+    m_stats.residentBytes = frames.residentBytes() + smoothedOffsetCache.residentBytes();
 
     int frameIndex = static_cast<int>(frame - motionOffsetsSimple.startFrame);
-
-    if (frameIndex < 0 || frameIndex >= motionOffsetsSimple.motionOffsets.size()) {
+    if (!frames.hasFrame(frameIndex)) {
         return MS::kSuccess;
     }
-
-    const MDoubleArray& offsets = motionOffsetsSimple.motionOffsets[frameIndex];
-    const std::vector<MPointArray>& trajectories = motionOffsetsSimple.vertexTrajectories;
-    const int numFrames = trajectories.size();
-
-    // Compute smoothed offsets, etc.
-    const bool smoothingEnabled = data.inputValue(smoothEnabled).asBool();
-    const int N = smoothingEnabled ? data.inputValue(smoothWindowSize).asInt() : 0;
-    std::vector<double> smoothedOffsets(offsets.length(), 0.0);
-    for (int vertIdx = 0; vertIdx < offsets.length(); ++vertIdx) {
-        double totalWeight = 0.0;
-        double smoothed = 0.0;
-        for (int n = -N; n <= N; ++n) {
-            const int frame = frameIndex + n;
-            if (frame < 0 || frame >= motionOffsetsSimple.motionOffsets.size()) continue;
-            const double normalized = std::abs(n) / static_cast<double>(N + 1);
-            const double weight = std::pow(1.0 - std::pow(normalized, 2.0), 2.0);
-            smoothed += motionOffsetsSimple.motionOffsets[frame][vertIdx] * weight;
-            totalWeight += weight;
-        }
-        smoothedOffsets[vertIdx] = totalWeight > 0.0 ? smoothed / totalWeight : offsets[vertIdx];
-    }
-
-    MPointArray mlPoints;
-    MIntArray mlFaceCounts;
-    MIntArray mlFaceConnects;
+    const int numFrames = frames.frameCount();
+    const float* smoothedOffsets = smoothedOffsetCache.offsets(frameIndex);
+    selectSeeds(frames, data.inputValue(aMotionLinesCount).asInt());
 
     // Artistic control param
     const double strengthPast = data.inputValue(aStrengthPast).asDouble();
     const double strengthFuture = data.inputValue(aStrengthFuture).asDouble();
     const int segmentCount = 3;
-    const double cylinderRadius = data.inputValue(aRadius).asDouble();
-
-    for (unsigned int s = 0; s < seedIndices.length(); s++) {
-        int vertexIndex = seedIndices[s];
+    resizeLines(data, frames, frameIndex, segmentCount);
 
-        // Get the smoothed offset for this vertex.
-        double offset = smoothedOffsets[vertexIndex];
+    {
+        SmearProfilingScope scope("Sample motion lines", m_stats.interpolateMs);
+        const int lineCount = static_cast<int>(seedIndices.length());
+        tbb::parallel_for(tbb::blocked_range<int>(0, lineCount, kLineGrainSize),
+            [&](const tbb::blocked_range<int>& range) {
+        MPointArray polyLine;
+        for (int s = range.begin(); s != range.end(); s++) {
+            int vertexIndex = seedIndices[s];
 
-        // Determine sampling direction:
-        // +1 for positive (leading) offsets, -1 for negative (trailing) offsets.
-        int direction = (offset >= 0.0) ? 1 : -1;
+            // Get the smoothed offset for this vertex.
+            double offset = smoothedOffsets[vertexIndex];
 
-        // Determine the appropriate motion line strength factor.
-        // These are assumed to be parameters from your node.
-        double strengthFactor = (offset >= 0.0) ? strengthFuture : strengthPast;
+            // Determine sampling direction:
+            // +1 for positive (leading) offsets, -1 for negative (trailing) offsets.
+            int direction = (offset >= 0.0) ? 1 : -1;
 
-        // Build a polyline along the vertex's trajectory.
-        // Instead of sampling consecutive frames, multiply the segment index by the strength factor.
-        MPointArray polyLine;
-        for (int seg = 0; seg <= segmentCount; seg++) {
-            // Calculate a frame increment scaled by the strength factor.
-            int frameIncrement = static_cast<int>(round(seg * strengthFactor));
-            int sampleFrame = frameIndex + frameIncrement * direction;
-            if (sampleFrame < 0 || sampleFrame >= numFrames)
-                break;
-            polyLine.append(trajectories[sampleFrame][vertexIndex]);
-        }
+            // Determine the appropriate motion line strength factor.
+            // These are assumed to be parameters from your node.
+            double strengthFactor = (offset >= 0.0) ? strengthFuture : strengthPast;
 
-        // Create cylinder segments between consecutive polyline points.
-        for (unsigned int j = 0; j < polyLine.length() - 1; j++) {
-            status = appendCylinder(polyLine[j], polyLine[j + 1], 2.0, 
-                mlPoints, mlFaceCounts, mlFaceConnects);
-            if (status != MS::kSuccess) {
-                MGlobal::displayError("Failed to append cylinder for motion line segment.");
-                return status;
+            // Build a polyline along the vertex's trajectory.
+            // Instead of sampling consecutive frames, multiply the segment index by the strength factor.
+            polyLine.clear();
+            for (int seg = 0; seg <= segmentCount; seg++) {
+                // Calculate a frame increment scaled by the strength factor.
+                int frameIncrement = static_cast<int>(round(seg * strengthFactor));
+                int sampleFrame = frameIndex + frameIncrement * direction;
+                if (sampleFrame < 0 || sampleFrame >= numFrames)
+                    break;
+                polyLine.append(Smear::toPoint(frames.position(sampleFrame, vertexIndex)));
             }
-        }
-    }
 
-    MFnMesh meshFn;
-    MObject motionLinesMesh = meshFn.create(mlPoints.length(), mlFaceCounts.length(),
-        mlPoints, mlFaceCounts, mlFaceConnects, newOutput, &status);
-    if (status != MS::kSuccess) {
-        MGlobal::displayError("Motion lines mesh creation failed.");
-        return status;
+            // Create cylinder segments between consecutive polyline points.
+            lineBuilder.setLine(s, polyLine, Smear::toPoint(frames.position(frameIndex, vertexIndex)));
+        }
+        });
     }
 
-    MDataHandle outputHandle = data.outputValue(aOutputMesh, &status);
-    CHECK_MSTATUS_AND_RETURN_IT(status);
-    outputHandle.set(newOutput);
-    data.setClean(plug);
-
-    return MS::kSuccess;
+    m_stats.verticesProcessed = lineBuilder.points().length();
+    SmearProfilingScope scope("Create motion lines mesh", m_stats.meshMs);
+    status = setOutputLines(plug, data);
+    return status;
 }
\ No newline at end of file
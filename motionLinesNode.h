@@ -1,48 +1,86 @@
 #pragma once
 #include "smearNode.h"
+#include "smoothedOffsets.h"
+#include "framePrefetcher.h"
+#include "smearStats.h"
+#include "motionLineBuilder.h"
+#include "skinBinding.h"
+#include "nodePreparation.h"
 #include <maya/MPxNode.h>
 #include <maya/MStatus.h>
 #include <maya/MObject.h>
 #include <maya/MPointArray.h>
 #include <maya/MIntArray.h>
 #include <maya/MFloatPointArray.h>
+#include <maya/MNodeMessage.h>
 
 // Forward declaration for LSystem::Branch if not already defined
 namespace LSystem {
     struct Branch;
 }
 
-class MotionLinesNode : public MPxNode
+class MotionLinesNode : public MPxNode, public PreparedNode
 {
 private: 
     // Caches motion offsets for simlpe objects. 
     // TODO: Add a way to cache motion offsets for non-simple objects
     MotionOffsetsSimple motionOffsetsSimple;
-    // Tracks whether motion offsets are baked to avoid recomputation of offsets every frame
-    bool motionOffsetsBaked;
+    // Cache bound through cachePath, held so the registry keeps it loaded
+    CacheRegistry::Handle boundCache;
+    // Pages in boundCache's upcoming frames during playback
+    FramePrefetcher prefetcher;
+    // boundCache's frames around the sampled one, when it is compressed
+    FrameWindow cacheWindow;
+    // Offsets of whichever store is in use, smoothed over the current window
+    SmoothedOffsets smoothedOffsetCache;
+    EvalStats m_stats;
+    // Whether the input mesh is skinned, resolved once per mesh
+    SkinBinding skinBinding;
+    // The mesh feeding aInputMesh, resolved by prepare()
+    MDagPath inputShapePath;
+    MDagPath inputTransformPath;
+    bool inputResolved;
+    bool inputArticulated;
+    MCallbackId inputCallback;
+    // Motion line geometry, reused across frames
+    MotionLineBuilder lineBuilder;
     
     // Stores motion line seed vertex indices
     MIntArray seedIndices;
     int cachedMotionLinesCount; 
+    int seededVertexCount;
 
-    // Selects seeds randomly 
-    MStatus selectSeeds(int count); 
+    // Re-selects seeds from the store's motion when the count or the vertex count changed
+    void selectSeeds(const FrameStore& frames, int count);
+    // Cylinder slices for this evaluation: motionLinesSlices, or fewer for thin lines and
+    // lines far from lodCameraPosition when level of detail is on
+    int lineSlices(MDataBlock& data, const FrameStore& frames, int frame, double radius) const;
+    // Resolves the input mesh and bakes it when it is not skinned
+    MStatus prepare() override;
+    static void inputConnectionChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData);
 
 public:
     MotionLinesNode();
     ~MotionLinesNode() override;
+    void postConstructor() override;
     static void* creator();
     static MStatus initialize();
     MStatus compute(const MPlug& plug, MDataBlock& data) override;
+    // compute only reads what prepare() left behind
+    SchedulingType schedulingType() const override { return PreparedNode::schedulingType(); }
+    MStatus computeMotionLines(const MPlug& plug, MDataBlock& data);
 
     const MStatus& computeSimple(MStatus& status, MObject& inputObj, MDataBlock& data, MDagPath& shapePath, MDagPath& transformPath, double frame, const MPlug& plug);
 
     static MTypeId id;  // Unique node ID
 
+    EvalStats& evalStats() { return m_stats; }
+
     // Attributes 
     static MObject time;
     static MObject aInputMesh;
     static MObject aOutputMesh;
+    static MObject aOutputCurves;
     static MObject smoothWindowSize;
     static MObject smoothEnabled;
     static MObject aStrengthPast;
@@ -51,7 +89,13 @@ public:
     static MObject aGenerateMotionLines;
     static MObject aMotionLinesCount;
     static MObject aRadius; 
+    static MObject aSlices;
+    static MObject aLevelOfDetail;
+    static MObject aLodCameraPosition;
+    static MObject aStyle;
     static MObject aCacheLoaded;
+    static MObject aCachePath;
+    static StatsAttributes statsAttributes;
 
     // Message attribute for connecting the control node.
     static MObject inputControlMsg;
@@ -59,7 +103,11 @@ public:
     // Helper function declarations for creating geometry
     MStatus setMotionLinesNone(const MPlug& plug, MDataBlock& data);
     MObject createMesh(const MTime& time, float angle, int stepSize, const MString& grammar, MObject& outData, MStatus& stat);
-    MStatus appendCylinder(MPoint start, MPoint end, double radius, MPointArray& points, MIntArray& faceCounts, MIntArray& faceConnects);
+    MStatus setOutputLines(const MPlug& plug, MDataBlock& data);
+    // One NURBS curve per line through the points it was built from
+    MStatus setOutputCurves(MDataBlock& data, int lineCount);
+    // Motion line style and the slices for it, set before the lines are built
+    void resizeLines(MDataBlock& data, const FrameStore& frames, int frame, int segmentCount);
     MObject createQuads(const MFloatPointArray& points, MObject& outData, MStatus& stat);
     MObject createReverseQuads(const MFloatPointArray& points, MObject& outData, MStatus& stat);
     MObject createTris(const MFloatPointArray& points, MObject& outData, MStatus& stat);
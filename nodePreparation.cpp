@@ -0,0 +1,65 @@
+#include "nodePreparation.h"
+#include <maya/MFnDependencyNode.h>
+#include <maya/MGlobal.h>
+#include <maya/MObjectHandle.h>
+#include <maya/MString.h>
+#include <memory>
+
+// Idle tasks only run in an interactive session
+static bool preparesOnIdle()
+{
+    return MGlobal::mayaState() == MGlobal::kInteractive;
+}
+
+bool PreparedNode::request(const MObject& node)
+{
+    MFnDependencyNode nodeFn(node);
+    PreparedNode* prepared = dynamic_cast<PreparedNode*>(nodeFn.userNode());
+    return prepared ? prepared->queue(node) : preparesOnIdle();
+}
+
+bool PreparedNode::queue(const MObject& node)
+{
+    if (!preparesOnIdle()) {
+        m_prepared = false;
+        return false;
+    }
+    if (!m_pending.exchange(true))
+        MGlobal::executeTaskOnIdle(runPrepare, new MObjectHandle(node));
+    return true;
+}
+
+MPxNode::SchedulingType PreparedNode::schedulingType()
+{
+    return preparesOnIdle() ? MPxNode::kParallel : MPxNode::kUntrusted;
+}
+
+void PreparedNode::prepareOrRequest(const MObject& node)
+{
+    if (!queue(node))
+        prepareNow();
+}
+
+void PreparedNode::runPrepare(void* data)
+{
+    std::unique_ptr<MObjectHandle> handle(static_cast<MObjectHandle*>(data));
+    if (!handle->isAlive())
+        return;
+    MFnDependencyNode nodeFn(handle->object());
+    PreparedNode* prepared = dynamic_cast<PreparedNode*>(nodeFn.userNode());
+    if (!prepared)
+        return;
+    prepared->m_pending = false;
+    // Deleted, but kept for undo; a request after the undo prepares it again
+    if (!handle->isValid())
+        return;
+    if (prepared->prepareNow())
+        MGlobal::executeCommand("dgdirty \"" + nodeFn.name() + "\"");
+}
+
+MStatus PreparedNode::prepareNow()
+{
+    MStatus status = prepare();
+    m_prepared = true;
+    return status;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <maya/MObject.h>
+#include <maya/MPxNode.h>
+#include <maya/MStatus.h>
+#include <atomic>
+
+/*
+Main-thread side of the smear nodes.
+
+Baking motion offsets pulls the transform's plugs at other times through
+MDGContext, resolving an input walks the graph and scans for skinClusters, and
+both register callbacks. None of that is safe while other nodes evaluate in
+parallel, so compute never does it. Nodes do it in prepare(), which request()
+queues as an idle task on the main thread, between evaluations; the node is
+dirtied once prepare() succeeds and compute reads what it left behind.
+
+compute requests a preparation before the first one has run and whenever what
+it reads no longer fits the scene (a bake in another time unit). Callbacks
+request one after edits: input connections, keys on the baked transform, the
+skinCluster chain. A failed prepare() does not dirty the node, so it is not
+retried until one of those changes.
+
+Batch sessions never go idle. There a request only marks the node unprepared,
+the next compute calls prepare() in place, as it always used to, and the node
+is scheduled to evaluate alone.
+*/
+
+class PreparedNode
+{
+public:
+    virtual ~PreparedNode() = default;
+
+    // Queues node's prepare() unless one is already queued; safe from any thread.
+    // False in batch sessions, where the next compute prepares in place
+    static bool request(const MObject& node);
+    // kParallel when preparations run on idle, kUntrusted when compute prepares in place
+    static MPxNode::SchedulingType schedulingType();
+
+protected:
+    // Runs on the main thread with no evaluation in progress
+    virtual MStatus prepare() = 0;
+    // For compute: runs prepare() now in batch sessions, queues it otherwise
+    void prepareOrRequest(const MObject& node);
+    // Whether prepare() has run since the node was created
+    bool hasPrepared() const { return m_prepared; }
+
+private:
+    bool queue(const MObject& node);
+    static void runPrepare(void* data);
+    MStatus prepareNow();
+
+    std::atomic<bool> m_pending{ false };
+    std::atomic<bool> m_prepared{ false };
+};
@@ -128,7 +128,12 @@ def _safe_bake():
         # Step 2: load the cache via MEL
         if cache_path:
             clean = cache_path.replace("\\","/")
-            mel.eval(f'loadCache "{clean}"')
+            # Bind the cache to this mesh's own nodes so other characters keep theirs
+            shapes = cmds.listRelatives(original_selection[0], shapes=True, fullPath=True) or []
+            related = (cmds.listHistory(shapes) or []) + (cmds.listHistory(shapes, future=True) or []) if shapes else []
+            smear_nodes = cmds.ls(related, type=["SmearDeformerNode", "MotionLinesNode"]) or []
+            node_flags = "".join(f'-node "{node}" ' for node in smear_nodes)
+            mel.eval(f'loadCache {node_flags}"{clean}"')
         update_progress(95)
 
         # Step 3: finalize
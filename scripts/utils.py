@@ -4,6 +4,7 @@ from maya.api import OpenMayaAnim  as oma
 import numpy as np
 from maya.api.OpenMaya import MVector
 import json
+import struct
 
 def get_selected_mesh():
     sel = cmds.ls(selection=True, dag=True, type='mesh')
@@ -296,6 +297,37 @@ def get_scene_fps():
     }
     return unit_to_fps.get(unit, 24.0)
 
+# Binary cache layout, see smearCache.h
+SMEAR_CACHE_MAGIC = b"SMRC"
+SMEAR_CACHE_VERSION = 1
+SMEAR_CACHE_ALIGNMENT = 64
+
+def _align(value):
+    return (value + SMEAR_CACHE_ALIGNMENT - 1) // SMEAR_CACHE_ALIGNMENT * SMEAR_CACHE_ALIGNMENT
+
+def write_binary_cache(output_path, start_frame, end_frame, fps, positions, offsets):
+    # positions: (frames, verts, 3), offsets: (frames, verts); stored as float32
+    positions = np.ascontiguousarray(positions, dtype="<f4")
+    offsets = np.ascontiguousarray(offsets, dtype="<f4")
+    num_frames, vertex_count = offsets.shape
+
+    header_size = 64
+    positions_offset = _align(header_size)
+    offsets_offset = _align(positions_offset + positions.nbytes)
+    file_size = offsets_offset + offsets.nbytes
+
+    header = struct.pack("<4sIIiiIIIdQQQ",
+                         SMEAR_CACHE_MAGIC, SMEAR_CACHE_VERSION, vertex_count,
+                         start_frame, end_frame, 4, 4, 0, float(fps),
+                         positions_offset, offsets_offset, file_size)
+
+    with open(output_path, "wb") as f:
+        f.write(header)
+        f.write(b"\0" * (positions_offset - header_size))
+        f.write(positions.tobytes())
+        f.write(b"\0" * (offsets_offset - positions_offset - positions.nbytes))
+        f.write(offsets.tobytes())
+
 def cache_vertex_trajectories_with_deltas(mesh_name, output_path, progress_fn=None):
     # Frame range
     start = int(cmds.playbackOptions(q=True, min=True))
@@ -316,6 +348,15 @@ def cache_vertex_trajectories_with_deltas(mesh_name, output_path, progress_fn=No
     np.max(np.abs(frame_deltas))
         for frame_deltas in deltas.values()
     )
+    if output_path.endswith(".smc"):
+        positions = np.stack([verts[frame] for frame in frames])
+        offsets = np.stack([np.asarray(deltas[frame]) for frame in frames])
+        if max_mag > 1e-6:
+            offsets = offsets / max_mag
+        write_binary_cache(output_path, start, end, get_scene_fps(), positions, offsets)
+        print(f"[SMEARin] Exported binary vertex trajectories + deltas to {output_path}")
+        return
+
     # Prepare final export structure
     vertex_count = len(verts[start])
     vertex_trajectories = {}
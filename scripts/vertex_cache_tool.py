@@ -31,11 +31,19 @@ def run_preprocess(progress_fn=None):
     # make a cache folder next to current working dir
     cache_dir = os.path.join(os.getcwd(), "cache")
     os.makedirs(cache_dir, exist_ok=True)
-    safe_name = meshShape.replace("|", "_").replace(":", "_")
-    output_path = os.path.join(cache_dir, f"{safe_name}_cache.json")
-
-    # now pass the shape name, not an MDagPath
-    cache_vertex_trajectories_with_deltas(meshShape, output_path, progress_fn=progress_fn)
+    # Shortest unique name, same rule as smearBake's default path (MDagPath::partialPathName)
+    short_name = (cmds.ls(meshShape) or [meshShape])[0]
+    safe_name = short_name.replace("|", "_").replace(":", "_")
+    output_path = os.path.join(cache_dir, f"{safe_name}_cache.smc")
+
+    # Native bake; evaluates the rig through a DG context, the UI time never moves.
+    # The pure Python path (cache_vertex_trajectories_with_deltas) is kept as a fallback.
+    if progress_fn:
+        progress_fn(5)
+    if hasattr(cmds, "smearBake"):
+        cmds.smearBake(meshShape, output=output_path)
+    else:
+        cache_vertex_trajectories_with_deltas(meshShape, output_path, progress_fn=progress_fn)
 
     print(f"[SMEARin] Preprocessing complete. Cache written to {output_path}")
     return output_path
@@ -0,0 +1,89 @@
+#include "skinBinding.h"
+#include "smear.h"
+#include "nodePreparation.h"
+#include <maya/MMessage.h>
+
+SkinBinding::SkinBinding() : m_stale(false)
+{}
+
+SkinBinding::~SkinBinding()
+{
+    clear();
+}
+
+bool SkinBinding::isArticulated(const MDagPath& meshPath, const MObject& node)
+{
+    const Binding& binding = resolve(meshPath, node);
+    // Need at least 2 joints for articulation
+    return binding.found && binding.influences.length() >= 2;
+}
+
+MStatus SkinBinding::skinClusterAndBones(const MDagPath& meshPath, const MObject& node, MObject& skinClusterObj, MDagPathArray& influenceBones)
+{
+    const Binding& binding = resolve(meshPath, node);
+    if (!binding.found)
+        return MS::kFailure;
+    skinClusterObj = binding.skinCluster;
+    influenceBones = binding.influences;
+    return MS::kSuccess;
+}
+
+void SkinBinding::clear()
+{
+    if (m_callbacks.length() > 0)
+        MMessage::removeCallbacks(m_callbacks);
+    m_callbacks.clear();
+    m_bindings.clear();
+    m_node = MObjectHandle();
+    m_stale = false;
+}
+
+const SkinBinding::Binding& SkinBinding::resolve(const MDagPath& meshPath, const MObject& node)
+{
+    if (m_stale.exchange(false) || !m_node.isValid() || m_node.object() != node)
+        clear();
+
+    MObject mesh = meshPath.node();
+    for (const Binding& binding : m_bindings) {
+        if (binding.mesh.isValid() && binding.mesh.object() == mesh)
+            return binding;
+    }
+
+    if (m_bindings.empty()) {
+        m_node = MObjectHandle(node);
+        MObject owner = node;
+        watch(owner);
+    }
+
+    Binding binding;
+    binding.mesh = MObjectHandle(mesh);
+    MStatus status = Smear::getSkinClusterAndBones(meshPath, binding.skinCluster, binding.influences);
+    binding.found = status && !binding.skinCluster.isNull();
+    watch(mesh);
+    if (binding.found)
+        watch(binding.skinCluster);
+
+    m_bindings.push_back(binding);
+    return m_bindings.back();
+}
+
+void SkinBinding::watch(MObject& object)
+{
+    // Without the callback the result would never go stale, so don't keep it
+    MStatus status;
+    MCallbackId id = MNodeMessage::addAttributeChangedCallback(object, connectionChanged, this, &status);
+    if (status)
+        m_callbacks.append(id);
+    else
+        m_stale = true;
+}
+
+void SkinBinding::connectionChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData)
+{
+    if (!(msg & (MNodeMessage::kConnectionMade | MNodeMessage::kConnectionBroken)))
+        return;
+    SkinBinding* binding = static_cast<SkinBinding*>(clientData);
+    binding->m_stale = true;
+    if (binding->m_node.isValid())
+        PreparedNode::request(binding->m_node.object());
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <maya/MObject.h>
+#include <maya/MObjectHandle.h>
+#include <maya/MDagPath.h>
+#include <maya/MDagPathArray.h>
+#include <maya/MPlug.h>
+#include <maya/MNodeMessage.h>
+#include <maya/MCallbackIdArray.h>
+#include <atomic>
+#include <vector>
+
+/*
+A node's answer to Smear::isMeshArticulated and Smear::getSkinClusterAndBones,
+kept until the deformation chain changes.
+
+The first lookup for a mesh scans the scene's skinClusters as before; later ones
+return the stored result. Connections made or broken on the owning node, the
+mesh or the skinCluster found for it (geometry rerouted, a skinCluster added or
+deleted, influences added or removed) only mark the results stale from their
+callbacks and request a preparation of the owning node, where the next lookup
+resolves again.
+*/
+
+class SkinBinding
+{
+public:
+    SkinBinding();
+    ~SkinBinding();
+    SkinBinding(const SkinBinding&) = delete;
+    SkinBinding& operator=(const SkinBinding&) = delete;
+
+    // Same as Smear::isMeshArticulated; node is the plugin node asking, watched for reconnections
+    bool isArticulated(const MDagPath& meshPath, const MObject& node);
+    // Same as Smear::getSkinClusterAndBones, fails when meshPath has no skinCluster
+    MStatus skinClusterAndBones(const MDagPath& meshPath, const MObject& node, MObject& skinClusterObj, MDagPathArray& influenceBones);
+    void clear();
+
+private:
+    struct Binding {
+        MObjectHandle mesh;
+        MObject skinCluster;
+        MDagPathArray influences;
+        bool found;
+    };
+
+    static void connectionChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData);
+    const Binding& resolve(const MDagPath& meshPath, const MObject& node);
+    void watch(MObject& object);
+
+    MObjectHandle m_node;
+    std::vector<Binding> m_bindings;
+    MCallbackIdArray m_callbacks;
+    // Set from the callbacks, read when the node is prepared
+    std::atomic<bool> m_stale;
+};
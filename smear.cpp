@@ -1,4 +1,9 @@
 ﻿#include "smear.h"
+#include "smearDeltas.h"
+#include "catmullRom.h"
+#include "smearMotion.h"
+#include "smearStats.h"
+#include "smearDeformerNode.h"
 #include <maya/MFnDependencyNode.h>
 #include <maya/MFnAnimCurve.h>
 #include <maya/MPlug.h>
@@ -19,7 +24,12 @@
 #include <maya/MItDependencyGraph.h>
 #include <maya/MDagPathArray.h>
 #include <maya/MItDag.h>
+#include <maya/MDGContext.h>
+#include <maya/MDGContextGuard.h>
+#include <maya/MFnSingleIndexedComponent.h>
+#include <maya/MEventMessage.h>
 #include <filesystem>
+#include <mutex>
 namespace fs = std::filesystem;
 
 #define McheckErr(stat, msg)        \
@@ -28,13 +38,13 @@ namespace fs = std::filesystem;
         return MS::kFailure;        \
     }
 
-std::unordered_map<int, FrameCache> Smear::vertexCache;
-int   Smear::vertexCount = 0;
+CacheRegistry::Handle Smear::vertexCache;
 MString Smear::lastCachePath = "";
-double Smear::cacheFPS = 24.0;
+MCallbackId Smear::timeUnitCallback = 0;
 
-MStatus Smear::extractAnimationFrameRange(const MDagPath & transformPath, double& startFrame, double& endFrame) {
+MStatus Smear::findAnimCurves(const MDagPath& transformPath, MObjectArray& curves) {
     MStatus status;
+    curves.clear();
 
     // Validate input
     if (!transformPath.isValid() || !transformPath.hasFn(MFn::kTransform)) {
@@ -42,17 +52,12 @@ MStatus Smear::extractAnimationFrameRange(const MDagPath & transformPath, double
         return MS::kFailure;
     }
 
-    MObject transformNode = transformPath.node();
-    startFrame = DBL_MAX;
-    endFrame = -DBL_MAX;
-
     // Attributes we want to check for animation
     const char* animAttrs[] = { "translateX", "translateY", "translateZ",
                                 "rotateX", "rotateY", "rotateZ",
                                 "scaleX", "scaleY", "scaleZ" };
 
-    MFnDependencyNode depNode(transformNode);
-    bool foundKeys = false;
+    MFnDependencyNode depNode(transformPath.node());
 
     // Check all relevant attributes
     for (const char* attrName : animAttrs) {
@@ -66,19 +71,37 @@ MStatus Smear::extractAnimationFrameRange(const MDagPath & transformPath, double
 
         for (unsigned int i = 0; i < connections.length(); ++i) {
             MObject node = connections[i].node();
-            if (!node.hasFn(MFn::kAnimCurve)) continue;
+            if (node.hasFn(MFn::kAnimCurve))
+                curves.append(node);
+        }
+    }
 
-            MFnAnimCurve animCurve(node, &status);
-            if (status != MS::kSuccess || animCurve.numKeys() == 0) continue;
+    return MS::kSuccess;
+}
 
-            // Update frame range
-            const double curveStart = animCurve.time(0).as(MTime::uiUnit());
-            const double curveEnd = animCurve.time(animCurve.numKeys() - 1).as(MTime::uiUnit());
+MStatus Smear::extractAnimationFrameRange(const MDagPath & transformPath, double& startFrame, double& endFrame) {
+    MStatus status;
 
-            startFrame = std::min(startFrame, curveStart);
-            endFrame = std::max(endFrame, curveEnd);
-            foundKeys = true;
-        }
+    MObjectArray curves;
+    status = findAnimCurves(transformPath, curves);
+    if (!status)
+        return status;
+
+    startFrame = DBL_MAX;
+    endFrame = -DBL_MAX;
+    bool foundKeys = false;
+
+    for (unsigned int i = 0; i < curves.length(); ++i) {
+        MFnAnimCurve animCurve(curves[i], &status);
+        if (status != MS::kSuccess || animCurve.numKeys() == 0) continue;
+
+        // Update frame range
+        const double curveStart = animCurve.time(0).as(MTime::uiUnit());
+        const double curveEnd = animCurve.time(animCurve.numKeys() - 1).as(MTime::uiUnit());
+
+        startFrame = std::min(startFrame, curveStart);
+        endFrame = std::max(endFrame, curveEnd);
+        foundKeys = true;
     }
 
     if (!foundKeys) {
@@ -150,30 +173,36 @@ MStatus Smear::computeWorldTransformPerFrame(const MDagPath& transformPath,
 
     MTransformationMatrix::RotationOrder rotOrder = fnTransform.rotationOrder();
 
+    // Get plugs for transform attributes once, only their values change per frame
+    MPlug translatePlug = depNode.findPlug("translate", true);
+    MPlug rotatePlug = depNode.findPlug("rotate", true);
+    MPlug scalePlug = depNode.findPlug("scale", true);
+    MPlug translatePlugs[3], rotatePlugs[3], scalePlugs[3];
+    for (unsigned int axis = 0; axis < 3; ++axis) {
+        translatePlugs[axis] = translatePlug.child(axis);
+        rotatePlugs[axis] = rotatePlug.child(axis);
+        scalePlugs[axis] = scalePlug.child(axis);
+    }
+
     for (int frame = 0; frame < numFrames; ++frame) {
         MTime currentTime(startFrame + frame, MTime::uiUnit());
         MDGContext context(currentTime);
 
-        // Get plugs for transform attributes
-        MPlug translatePlug = depNode.findPlug("translate", true);
-        MPlug rotatePlug = depNode.findPlug("rotate", true);
-        MPlug scalePlug = depNode.findPlug("scale", true);
-
         // Evaluate plugs at this time
         MVector translation(
-            translatePlug.child(0).asDouble(context),
-            translatePlug.child(1).asDouble(context),
-            translatePlug.child(2).asDouble(context));
+            translatePlugs[0].asDouble(context),
+            translatePlugs[1].asDouble(context),
+            translatePlugs[2].asDouble(context));
 
         double rotation[3] = {
-            rotatePlug.child(0).asDouble(context),
-            rotatePlug.child(1).asDouble(context),
-            rotatePlug.child(2).asDouble(context) };
+            rotatePlugs[0].asDouble(context),
+            rotatePlugs[1].asDouble(context),
+            rotatePlugs[2].asDouble(context) };
 
         double scale[3] = {
-            scalePlug.child(0).asDouble(context),
-            scalePlug.child(1).asDouble(context),
-            scalePlug.child(2).asDouble(context)};
+            scalePlugs[0].asDouble(context),
+            scalePlugs[1].asDouble(context),
+            scalePlugs[2].asDouble(context)};
 
         // Build transform matrix manually
         MTransformationMatrix xform;
@@ -186,187 +215,146 @@ MStatus Smear::computeWorldTransformPerFrame(const MDagPath& transformPath,
     return MS::kSuccess;
 }
 
-MStatus Smear::computeCentroidLocal(const MDagPath& shapePath, const MDagPath& transformPath, MVector& centroidLocal) {
-    MStatus status;
-
-    // Check if the provided path point to correct node types.
-    if (!shapePath.hasFn(MFn::kMesh)) {
-        MGlobal::displayError("Smear::calculateCentroidOffsetFromPivot - meshPath does not point to a mesh node.");
-        return MS::kFailure; // Not a mesh node.
-    }
-    else if (!transformPath.hasFn(MFn::kTransform)) {
-        MGlobal::displayError("Smear::calculateCentroidOffsetFromPivot - tranformPath does not point to a transform node.");
-        return MS::kFailure; // Not a transform node.
-    }
-
-    // Calculate the centroid using the shape node
-    MFnMesh meshFn(shapePath.node(), &status);
-    McheckErr(status, "Failed to create MFnMesh.");
-
-    MVector sum(0.0, 0.0, 0.0);
-    int numVertices = meshFn.numVertices();
-    MItMeshVertex vertexIt(shapePath.node(), &status);
-    McheckErr(status, "Failed to create MItMeshVertex.");
-
-
-    // Debug: Print vertex positions
-    //MGlobal::displayInfo("Vertex positions:");
-    for (; !vertexIt.isDone(); vertexIt.next()) {
-        MPoint vertexPos = vertexIt.position(MSpace::kObject);
-        //MGlobal::displayInfo(MString("Vertex ") + vertexIt.index() + ": " + vertexPos.x + ", " + vertexPos.y + ", " + vertexPos.z);
-        sum += vertexPos;
-    }
-
-    centroidLocal = (numVertices > 0) ? sum / numVertices : MVector(0.0, 0.0, 0.0);
-
-    return MS::kSuccess;
-}
-
-MStatus Smear::computeCentroidTrajectory(double startFrame, double endFrame, const std::vector<MTransformationMatrix>& transformationMatrices, 
-                                         const MVector& centroidLocal, std::vector<MVector>& centroidPositions) {
-    MStatus status;
-    int numFrames = static_cast<int>(endFrame - startFrame + 1);
-    centroidPositions.resize(numFrames);
-    // MGlobal::displayInfo("Smear::computeCentroidTrajectory - centroid positions");
-    for (int frame = 0; frame < numFrames; ++frame) {
-        // Find how the position of the centroid changes based on the pivot's transformations (how it moves, rotates, scales) 
-        // by multiplying the transform to centroid offset 
-        MPoint transformedOffset = MPoint(centroidLocal) * transformationMatrices[frame].asMatrix();
-
-        centroidPositions[frame] = MVector(transformedOffset);
+// Object-space xyz floats to world space, written straight into a frame of the store
+static void transformPoints(const float* objectPositions, int count, const MMatrix& m, float* worldPositions)
+{
+    for (int v = 0; v < count; ++v) {
+        const double x = objectPositions[v * 3 + 0];
+        const double y = objectPositions[v * 3 + 1];
+        const double z = objectPositions[v * 3 + 2];
+        worldPositions[v * 3 + 0] = static_cast<float>(x * m[0][0] + y * m[1][0] + z * m[2][0] + m[3][0]);
+        worldPositions[v * 3 + 1] = static_cast<float>(x * m[0][1] + y * m[1][1] + z * m[2][1] + m[3][1]);
+        worldPositions[v * 3 + 2] = static_cast<float>(x * m[0][2] + y * m[1][2] + z * m[2][2] + m[3][2]);
     }
-
-    return MS::kSuccess;
 }
 
-MStatus Smear::computeCentroidVelocity(const std::vector<MVector>& centroidPositions, std::vector<MVector>& centroidVelocities) {
+// Anything keyed, driven by time or by an expression upstream of node can change its output. A smear
+// deformer's time input only drives its own smear, so the walk goes on through its input geometry instead
+static bool isUpstreamTimeDependent(MObject node)
+{
     MStatus status;
+    MItDependencyGraph dgIt(node, MFn::kInvalid,
+        MItDependencyGraph::kUpstream,
+        MItDependencyGraph::kDepthFirst,
+        MItDependencyGraph::kNodeLevel, &status);
+    if (!status)
+        return true;
 
-    // Check if there are at least two frames
-    int numFrames = static_cast<int>(centroidPositions.size());
-    if (numFrames < 2) {
-        MGlobal::displayError("Not enough frames to compute velocity.");
-        return MS::kFailure;
-    }
+    for (; !dgIt.isDone(); dgIt.next()) {
+        MObject current = dgIt.currentItem();
+        if (current.hasFn(MFn::kAnimCurve) || current.hasFn(MFn::kTime) || current.hasFn(MFn::kExpression))
+            return true;
+        if (MFnDependencyNode(current).typeId() != SmearDeformerNode::id)
+            continue;
 
-    // Use the centroid positions to compute centroid velocity at each frame
-    centroidVelocities.resize(numFrames - 1);
-    // MGlobal::displayInfo("Smear::computeCentroidVelocity - centroid positions");
-    for (int frame = 0; frame < numFrames - 1; ++frame) {
-        centroidVelocities[frame] = centroidPositions[frame + 1] - centroidPositions[frame];
+        dgIt.prune();
+        MPlug inputPlug(current, SmearDeformerNode::input);
+        for (unsigned int i = 0; i < inputPlug.numElements(); ++i) {
+            MPlug geomPlug = inputPlug.elementByPhysicalIndex(i).child(SmearDeformerNode::inputGeom);
+            MPlugArray sources;
+            geomPlug.connectedTo(sources, true, false);
+            for (unsigned int s = 0; s < sources.length(); ++s) {
+                if (isUpstreamTimeDependent(sources[s].node()))
+                    return true;
+            }
+        }
     }
-
-    return MS::kSuccess;
+    return false;
 }
 
-MStatus Smear::computeSignedDistanceToPlane(const MPoint& point, const MPoint& pointOnPlane, const MVector& planeNormal, double& signedDist)
+bool Smear::isShapeTimeDependent(const MDagPath& shapePath)
 {
-    MStatus status;
-
-    MVector diff = point - pointOnPlane;
-    signedDist = diff * planeNormal;  // Dot product
-
-    return MS::kSuccess;
+    return isUpstreamTimeDependent(shapePath.node());
 }
 
-MStatus Smear::calculatePerFrameMotionOffsets(const MPointArray& objectSpaceVertices, const MTransformationMatrix& transformationMatrix, const MPoint& centroid, const MVector& centroidVelocity, MDoubleArray& motionOffsets)
+MStatus Smear::sampleWorldPositions(const MDagPath& shapePath, const MDagPath& transformPath, double startFrame,
+    const float* restPositions, FrameStore& frames, int firstIndex, int lastIndex)
 {
     MStatus status;
-    // Store the magnitude of the largest motion offset
-    // to be used in normalizing motion offsets later
-    double maxMotionOffsetMag = DBL_MIN;
-
-    // Iterate and compute signed distance from the plane formed by the centroid and its velocity 
-    // for each vertex
-    int vertCount = objectSpaceVertices.length();
-    status = motionOffsets.setLength(vertCount);
-    McheckErr(status, "SmearNode::computeMotionOffsets - invalid vertex count!");
-
-    for (int i = 0; i < vertCount; ++i) {
-        double& motionOffset = motionOffsets[i];
-        const MPoint& objectSpaceVertexPosition = objectSpaceVertices[i];
-
-        // Convert the object space vertex postiion to world position 
-        MPoint worldSpaceVertexPosition =  objectSpaceVertexPosition * transformationMatrix.asMatrix();
-        // Motion offset for simple object is just the signed dist to plane
-        status = computeSignedDistanceToPlane(worldSpaceVertexPosition, centroid, centroidVelocity.normal(), motionOffset);
-        
-        // Check the magnitude of motion offset and record if it's the largest so far 
-        maxMotionOffsetMag = std::max(maxMotionOffsetMag, std::abs(motionOffset));
-    }
-
-    // Normalize motion offsets 
-    for (int i = 0; i < vertCount; ++i) {
-        motionOffsets[i] /= maxMotionOffsetMag; 
-        motionOffsets[i] = std::max(-1.0, std::min(1.0, motionOffsets[i]));
-        //MGlobal::displayInfo(MString("Motion Offset Post: ") + motionOffsets[i]);
-    }
-    //MGlobal::displayInfo("Smear::calculatePerFrameMotionOffsets - completed!");
-    return MS::kSuccess; 
-}
-
-MStatus Smear::getVerticesAtFrame(const MDagPath& shapePath, const MDagPath& transformPath, double frame, MPointArray& vertices) {
-    MStatus status;
-
-    // Set up frame evaluation context
-    MTime evalTime(frame, MTime::kFilm);
-    MDGContext ctx(evalTime);
+    const int numVertices = frames.vertexCount();
 
-    // Get worldMatrix array plug
+    // Resolve the plugs once for the whole range
     MFnDependencyNode transformFn(transformPath.node());
     MPlug worldMatrixPlug = transformFn.findPlug("worldMatrix", true, &status);
     McheckErr(status, "Failed to find worldMatrix plug");
-
-    // Access first element of worldMatrix array
-    MPlug elementPlug = worldMatrixPlug.elementByLogicalIndex(0, &status);
+    worldMatrixPlug = worldMatrixPlug.elementByLogicalIndex(0, &status);
     McheckErr(status, "Failed to get worldMatrix[0]");
-        
-    // Get matrix data in context
-    MObject matrixData;
-    elementPlug.getValue(matrixData, ctx);
-    if (matrixData.isNull()) {
-        MGlobal::displayError("Null matrix data received");
-        return MS::kFailure;
-    }
 
-    // Validate matrix data type
-    if (!matrixData.hasFn(MFn::kMatrixData)) {
-        MGlobal::displayError("Matrix data has incorrect type");
-        return MS::kFailure;
-    }
-
-    // Extract matrix from data
-    MFnMatrixData matrixFn(matrixData, &status);
-    McheckErr(status, "Failed to create MFnMatrixData");
-
-    MMatrix worldMatrix = matrixFn.matrix();
-
-    // Get object-space vertices in context
     MFnDependencyNode shapeNode(shapePath.node());
     MPlug outMeshPlug = shapeNode.findPlug("outMesh", true, &status);
     McheckErr(status, "Failed to find outMesh plug");
 
-    MObject meshData;
-    outMeshPlug.getValue(meshData, ctx);
-    if (meshData.isNull()) {
-        MGlobal::displayError("Null mesh data received");
-        return MS::kFailure;
+    // A rigid mesh keeps its object-space points, only the matrix changes per frame
+    const bool rigid = !isShapeTimeDependent(shapePath);
+
+    for (int frame = firstIndex; frame <= lastIndex; ++frame) {
+        // Pull the graph at this frame without moving the UI time
+        MDGContext context(MTime(startFrame + frame, MTime::uiUnit()));
+        MDGContextGuard contextGuard(context);
+
+        MObject matrixData = worldMatrixPlug.asMObject(&status);
+        if (!status || !matrixData.hasFn(MFn::kMatrixData)) {
+            MGlobal::displayError("Matrix data has incorrect type");
+            return MS::kFailure;
+        }
+        const MMatrix worldMatrix = MFnMatrixData(matrixData).matrix();
+
+        if (rigid) {
+            transformPoints(restPositions, numVertices, worldMatrix, frames.mutablePositions(frame));
+            continue;
+        }
+
+        MObject meshData = outMeshPlug.asMObject(&status);
+        McheckErr(status, "Failed to evaluate outMesh at frame " + MString() + (startFrame + frame));
+        MFnMesh meshFn(meshData, &status);
+        McheckErr(status, "Failed to create MFnMesh");
+        if (meshFn.numVertices() != numVertices) {
+            MGlobal::displayError("Vertex count changed at frame " + MString() + (startFrame + frame));
+            return MS::kFailure;
+        }
+
+        // Read the points in place instead of copying them into an MPointArray
+        const float* objectPositions = meshFn.getRawPoints(&status);
+        McheckErr(status, "Failed to get object-space vertices");
+        transformPoints(objectPositions, numVertices, worldMatrix, frames.mutablePositions(frame));
     }
 
-    // Get object-space vertices
-    MFnMesh meshFn(meshData, &status);
-    McheckErr(status, "Failed to create MFnMesh")
+    return MS::kSuccess;
+}
+
+MStatus Smear::getRestPositions(const MDagPath& shapePath, std::vector<float>& restPositions) {
+    MStatus status;
+    MFnMesh meshFn(shapePath, &status);
+    McheckErr(status, "Failed to create MFnMesh.");
 
-    MPointArray objSpaceVerts;
-    status = meshFn.getPoints(objSpaceVerts, MSpace::kObject);
-    McheckErr(status, "Failed to get object-space vertices");
+    MPointArray objectSpaceVertices;
+    status = meshFn.getPoints(objectSpaceVertices, MSpace::kObject);
+    McheckErr(status, "Failed to get object space vertex positions");
 
-    // Transform to world space
-    vertices.setLength(objSpaceVerts.length());
-    for (unsigned int i = 0; i < objSpaceVerts.length(); ++i) {
-        vertices[i] = objSpaceVerts[i] * worldMatrix;
+    restPositions.resize(static_cast<size_t>(objectSpaceVertices.length()) * 3);
+    for (unsigned int v = 0; v < objectSpaceVertices.length(); ++v) {
+        restPositions[v * 3 + 0] = static_cast<float>(objectSpaceVertices[v].x);
+        restPositions[v * 3 + 1] = static_cast<float>(objectSpaceVertices[v].y);
+        restPositions[v * 3 + 2] = static_cast<float>(objectSpaceVertices[v].z);
     }
+    return MS::kSuccess;
+}
+
+MStatus Smear::computeFrameMatrices(const MDagPath& transformPath, double startFrame, double endFrame, std::vector<double>& matrices) {
+    MStatus status;
+    std::vector<MTransformationMatrix> transformationMatrices;
+    status = computeWorldTransformPerFrame(transformPath, startFrame, endFrame, transformationMatrices);
+    McheckErr(status, "Failed to compute world transforms.");
 
+    // Flattened row-major, as the core offsets code takes them
+    matrices.resize(transformationMatrices.size() * 16);
+    for (size_t f = 0; f < transformationMatrices.size(); ++f) {
+        const MMatrix matrix = transformationMatrices[f].asMatrix();
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c)
+                matrices[f * 16 + r * 4 + c] = matrix[r][c];
+        }
+    }
     return MS::kSuccess;
 }
 
@@ -392,64 +380,118 @@ MStatus Smear::computeMotionOffsetsSimple(const MDagPath& shapePath, const MDagP
     motionOffsets.startFrame = startFrame;
     motionOffsets.endFrame = endFrame;
 
+    const int numFrames = static_cast<int>(endFrame - startFrame + 1);
+    if (numFrames < 2) {
+        MGlobal::displayError("Not enough frames to compute velocity.");
+        return MS::kFailure;
+    }
+
     // Parse all the transformations from each frame to see how the pivot moves from animation 
-    std::vector<MTransformationMatrix> transformationMatrices;
-    status = computeWorldTransformPerFrame(transformPath, startFrame, endFrame, transformationMatrices);
+    std::vector<double> matrices;
+    status = computeFrameMatrices(transformPath, startFrame, endFrame, matrices);
     McheckErr(status, "Failed to compute world transforms.");
 
-    // Compute the centroid offset so that we can use this to 
-    // quickly find the centroid based on pivot location 
-    // Centroid is found through average position of vertex positions
-    MVector centroidLocal;
-    status = computeCentroidLocal(shapePath, transformPath, centroidLocal);
-    McheckErr(status, "Failed to calculate centroid offset.");
+    // These object space vertices will be transformed into world space vertices later
+    std::vector<float> restPositions;
+    status = getRestPositions(shapePath, restPositions);
+    McheckErr(status, "Smear::computeMotionOffsetsSimple - Failed to get object space vertex positions");
+    const int numVertices = static_cast<int>(restPositions.size() / 3);
 
-    // Calculate the centroid's positions over time 
-    std::vector<MVector> centroidPositions; 
-    status = computeCentroidTrajectory(startFrame, endFrame, transformationMatrices, centroidLocal, centroidPositions);
-    
-    // Just passing along centroid velocity for now 
-    // No real motion offset calculation yet 
-    std::vector<MVector> centroidVelocities;
-    status = computeCentroidVelocity(centroidPositions, centroidVelocities);
-    McheckErr(status, "Failed to compute centroid velocity.");
+    // Store vertex trajectories and offsets densely, one block per frame
+    FrameStore& frames = motionOffsets.frames;
+    frames.allocate(static_cast<int>(startFrame), numFrames, numVertices, sceneFps());
+
+    // World-space trajectories for the whole range in one pass
+    status = sampleWorldPositions(shapePath, transformPath, startFrame, restPositions.data(), frames, 0, numFrames - 1);
+    McheckErr(status, "Failed to get world-space vertices");
+
+    // Offsets from the centroid's motion, see core/smearMotion.h
+    computeSimpleOffsets(restPositions.data(), numVertices, matrices.data(), numFrames, 0, numFrames - 1, frames.mutableOffsets(0));
     
-    const int numFrames = static_cast<int>(endFrame - startFrame + 1);
-    if (numFrames == 0) {
-        MGlobal::displayError("No motion detected.");
-        return MS::kFailure;
+    return MS::kSuccess;
+}
+
+MStatus Smear::rebakeMotionOffsetsSimple(const MDagPath& shapePath, const MDagPath& transformPath, MotionOffsetsSimple& motionOffsets, int& firstIndex, int& lastIndex) {
+    MStatus status;
+    FrameStore& frames = motionOffsets.frames;
+    const int numFrames = frames.frameCount();
+    const int numVertices = frames.vertexCount();
+    const double startFrame = motionOffsets.startFrame;
+    if (numFrames < 2) {
+        status = computeMotionOffsetsSimple(shapePath, transformPath, motionOffsets);
+        firstIndex = 0;
+        lastIndex = motionOffsets.frames.frameCount() - 1;
+        return status;
     }
-    
-    motionOffsets.motionOffsets.resize(numFrames);
-    MFnMesh meshFn(shapePath, &status);
-    McheckErr(status, "computeMotionOffsetsSimple: Failed to create MFnMesh.");
-    int numVertices = meshFn.numVertices();
 
-    // These object space vertices will be transformed into world space verteices later
-    MPointArray objectSpaceVertices;
-    status = meshFn.getPoints(objectSpaceVertices, MSpace::kObject);
-    McheckErr(status, "Smear::computeMotionOffsetsSimple - Failed to get object space vertex positions");
-    
-    //MGlobal::displayInfo("Smear::computeMotionOffsetsSimple - Num Frames frame:" + MString() + numFrames);
+    // Offsets at frame f use the centroid velocity from f to f + 1 (the last frame reuses the one before),
+    // so the frame before the edit gets new offsets too and the transforms are needed one frame past it
+    const int firstPosition = std::max(0, firstIndex);
+    const int lastPosition = std::min(numFrames - 1, lastIndex);
+    const int firstOffset = std::max(0, firstPosition - 1);
+    const int lastOffset = lastPosition;
+    const int firstTransform = std::min(firstOffset, numFrames - 2);
+    const int lastTransform = std::min(numFrames - 1, lastOffset + 1);
 
-    // Store vertex trajectories
-    motionOffsets.vertexTrajectories.resize(numFrames);
-    MPointArray vertices;
+    std::vector<double> matrices;
+    status = computeFrameMatrices(transformPath, startFrame + firstTransform, startFrame + lastTransform, matrices);
+    McheckErr(status, "Failed to compute world transforms.");
 
-    // Iterate through each frame to find motion offsets for each frame
-    for (int frame = 0; frame < numFrames; ++frame) {
-        //MGlobal::displayInfo("Smear::computeMotionOffsetsSimple - Current frame:" + MString() + frame);
+    std::vector<float> restPositions;
+    status = getRestPositions(shapePath, restPositions);
+    McheckErr(status, "Smear::rebakeMotionOffsetsSimple - Failed to get object space vertex positions");
+    if (static_cast<int>(restPositions.size() / 3) != numVertices) {
+        // Topology changed under the bake, start over
+        status = computeMotionOffsetsSimple(shapePath, transformPath, motionOffsets);
+        firstIndex = 0;
+        lastIndex = motionOffsets.frames.frameCount() - 1;
+        return status;
+    }
+
+    status = sampleWorldPositions(shapePath, transformPath, startFrame, restPositions.data(), frames, firstPosition, lastPosition);
+    McheckErr(status, "Failed to get world-space vertices");
 
-        status = getVerticesAtFrame(shapePath, transformPath, startFrame + frame, vertices);
-        McheckErr(status, "Failed to get world-space vertices");
+    // The matrices start at firstTransform, so offset the frames and the output to match
+    computeSimpleOffsets(restPositions.data(), numVertices, matrices.data(), lastTransform - firstTransform + 1,
+        firstOffset - firstTransform, lastOffset - firstTransform, frames.mutableOffsets(firstTransform));
 
-        motionOffsets.vertexTrajectories[frame] = vertices;
+    firstIndex = firstOffset;
+    lastIndex = lastOffset;
+    return MS::kSuccess;
+}
 
-        MDoubleArray& currentFrameMotionOffsets = motionOffsets.motionOffsets[frame];
-        status = calculatePerFrameMotionOffsets(objectSpaceVertices, transformationMatrices[frame], centroidPositions[frame], centroidVelocities[frame], currentFrameMotionOffsets);
-        McheckErr(status, "Failed to calculate per frame motion offset for frame " + MString() + frame); 
+MStatus Smear::updateMotionOffsetsSimple(const MDagPath& shapePath, const MDagPath& transformPath, const MObject& node, MotionOffsetsSimple& motionOffsets, int& firstIndex, int& lastIndex) {
+    MStatus status;
+
+    // A bake numbered in another time unit only comes right with a full bake
+    const bool rateChanged = !motionOffsets.frames.empty() && std::abs(motionOffsets.frames.fps() - sceneFps()) > 1e-6;
+    int dirtyFirst, dirtyLast;
+    const AnimCurveWatcher::Change change = motionOffsets.watcher.poll(transformPath, dirtyFirst, dirtyLast);
+    switch (rateChanged ? AnimCurveWatcher::Change::All : change) {
+    case AnimCurveWatcher::Change::None:
+        firstIndex = 0;
+        lastIndex = -1;
+        return MS::kSuccess;
+    case AnimCurveWatcher::Change::Frames: {
+        SmearProfilingScope scope("Re-bake motion offsets", motionOffsets.bakeMs);
+        firstIndex = dirtyFirst;
+        lastIndex = dirtyLast;
+        return rebakeMotionOffsetsSimple(shapePath, transformPath, motionOffsets, firstIndex, lastIndex);
+    }
+    case AnimCurveWatcher::Change::All:
+        break;
     }
-    
+
+    {
+        SmearProfilingScope scope("Bake motion offsets", motionOffsets.bakeMs);
+        status = computeMotionOffsetsSimple(shapePath, transformPath, motionOffsets);
+    }
+    McheckErr(status, "Failed to compute motion offsets");
+    motionOffsets.watcher.watch(transformPath, node,
+        static_cast<int>(motionOffsets.startFrame), static_cast<int>(motionOffsets.endFrame));
+
+    firstIndex = 0;
+    lastIndex = motionOffsets.frames.frameCount() - 1;
     return MS::kSuccess;
 }
 
@@ -552,6 +594,121 @@ bool Smear::isMeshArticulated(const MDagPath& meshPath)
     return true;
 }
 
+MStatus Smear::bakeArticulated(const MDagPath& meshPath, int startFrame, int endFrame, int smoothWindow, FrameStore& cache)
+{
+    MStatus status;
+
+    MDagPath shapePath = meshPath;
+    status = shapePath.extendToShape();
+    McheckErr(status, "Smear::bakeArticulated - Path does not lead to a mesh.");
+
+    MObject skinClusterObj;
+    MDagPathArray influences;
+    status = getSkinClusterAndBones(shapePath, skinClusterObj, influences);
+    if (status != MS::kSuccess || skinClusterObj.isNull()) {
+        MGlobal::displayError("Smear::bakeArticulated - " + shapePath.partialPathName() + " has no skinCluster.");
+        return MS::kFailure;
+    }
+
+    MFnSkinCluster skinFn(skinClusterObj, &status);
+    McheckErr(status, "Smear::bakeArticulated - Failed to attach to skinCluster.");
+    MFnMesh meshFn(shapePath, &status);
+    McheckErr(status, "Smear::bakeArticulated - Failed to create MFnMesh.");
+
+    const int vertexCount = meshFn.numVertices();
+    const int frameCount = endFrame - startFrame + 1;
+    const int boneCount = static_cast<int>(influences.length());
+    if (vertexCount == 0 || frameCount <= 0) {
+        MGlobal::displayError("Smear::bakeArticulated - Nothing to bake.");
+        return MS::kFailure;
+    }
+
+    // Dense skin weights, vertexCount x boneCount
+    MFnSingleIndexedComponent componentFn;
+    MObject allVertices = componentFn.create(MFn::kMeshVertComponent, &status);
+    componentFn.setCompleteData(vertexCount);
+    MDoubleArray skinWeights;
+    unsigned int influenceCount = 0;
+    status = skinFn.getWeights(shapePath, allVertices, skinWeights, influenceCount);
+    McheckErr(status, "Smear::bakeArticulated - Failed to read skin weights.");
+    // Columns follow influenceObjects(); any other shape would read them with the wrong stride
+    std::vector<float> weights(static_cast<size_t>(vertexCount) * boneCount);
+    if (static_cast<int>(influenceCount) != boneCount || skinWeights.length() != weights.size()) {
+        MGlobal::displayError(MString("Smear::bakeArticulated - skinCluster returned ") + skinWeights.length()
+            + " weights for " + influenceCount + " influences, expected " + vertexCount + " x " + boneCount + ".");
+        return MS::kFailure;
+    }
+    for (size_t i = 0; i < weights.size(); ++i)
+        weights[i] = static_cast<float>(skinWeights[static_cast<unsigned int>(i)]);
+
+    // Skinned points come straight from the skinCluster output, so nothing downstream
+    // of it (including a smear deformer) feeds back into the bake
+    const unsigned int geometryIndex = skinFn.indexForOutputShape(shapePath.node(), &status);
+    McheckErr(status, "Smear::bakeArticulated - Mesh is not an output of its skinCluster.");
+    MPlug skinnedGeometryPlug = skinFn.findPlug("outputGeometry", true).elementByLogicalIndex(geometryIndex);
+    MPlug meshMatrixPlug = meshFn.findPlug("worldMatrix", true).elementByLogicalIndex(shapePath.instanceNumber());
+
+    // Joint heads and tails: the joint's and its first child joint's world translation
+    std::vector<MPlug> headPlugs(boneCount), tailPlugs(boneCount);
+    for (int k = 0; k < boneCount; ++k) {
+        MFnDagNode boneFn(influences[k]);
+        headPlugs[k] = boneFn.findPlug("worldMatrix", true).elementByLogicalIndex(0);
+        tailPlugs[k] = headPlugs[k];
+        for (unsigned int c = 0; c < boneFn.childCount(); ++c) {
+            MObject child = boneFn.child(c);
+            if (child.hasFn(MFn::kJoint)) {
+                tailPlugs[k] = MFnDagNode(child).findPlug("worldMatrix", true).elementByLogicalIndex(0);
+                break;
+            }
+        }
+    }
+
+    cache.allocate(startFrame, frameCount, vertexCount, MTime(1.0, MTime::kSeconds).as(MTime::uiUnit()));
+    std::vector<BonePose> poses(static_cast<size_t>(frameCount) * boneCount);
+
+    auto translation = [](const MPlug& matrixPlug, float* out) {
+        const MMatrix matrix = MFnMatrixData(matrixPlug.asMObject()).matrix();
+        out[0] = static_cast<float>(matrix[3][0]);
+        out[1] = static_cast<float>(matrix[3][1]);
+        out[2] = static_cast<float>(matrix[3][2]);
+    };
+
+    MPointArray points;
+    for (int f = 0; f < frameCount; ++f) {
+        // Pull the graph at this frame without moving the UI time
+        MDGContext context(MTime(static_cast<double>(startFrame + f), MTime::uiUnit()));
+        MDGContextGuard contextGuard(context);
+
+        MObject skinnedMesh = skinnedGeometryPlug.asMObject(&status);
+        McheckErr(status, "Smear::bakeArticulated - Failed to evaluate skinned mesh at frame " + MString() + (startFrame + f));
+        MFnMesh skinnedFn(skinnedMesh);
+        skinnedFn.getPoints(points, MSpace::kObject);
+        if (static_cast<int>(points.length()) != vertexCount) {
+            MGlobal::displayError("Smear::bakeArticulated - Vertex count changed at frame " + MString() + (startFrame + f));
+            return MS::kFailure;
+        }
+
+        const MMatrix toWorld = MFnMatrixData(meshMatrixPlug.asMObject()).matrix();
+        float* framePositions = cache.mutablePositions(f);
+        for (int v = 0; v < vertexCount; ++v) {
+            const MPoint world = points[v] * toWorld;
+            framePositions[v * 3 + 0] = static_cast<float>(world.x);
+            framePositions[v * 3 + 1] = static_cast<float>(world.y);
+            framePositions[v * 3 + 2] = static_cast<float>(world.z);
+        }
+
+        for (int k = 0; k < boneCount; ++k) {
+            BonePose& pose = poses[static_cast<size_t>(f) * boneCount + k];
+            translation(headPlugs[k], pose.head);
+            translation(tailPlugs[k], pose.tail);
+        }
+    }
+
+    computeArticulatedDeltas(cache.positions(0), poses.data(), weights.data(),
+        frameCount, vertexCount, boneCount, smoothWindow, cache.mutableOffsets(0));
+    return MS::kSuccess;
+}
+
 MString createCachePath(const MString& meshName) {
     // Get current working directory
     fs::path cwd = fs::current_path();
@@ -569,93 +726,128 @@ MString createCachePath(const MString& meshName) {
 
 bool Smear::loadCache(const MString& cachePath)
 {
-    if (lastCachePath == cachePath && !vertexCache.empty())
-        return true;
+    SmearProfilingScope scope("Load cache", SmearProfiler::cacheLoadMs);
 
-    clearVertexCache();
-    lastCachePath = cachePath;
+    // An explicit load always reads the file again, it may have been re-baked
+    CacheRegistry::invalidate(cachePath.asChar());
 
-    try
-    {
-        std::ifstream file(cachePath.asChar(), std::ios::binary);
-        if (!file.is_open())
-            return false;
-
-        json data;
-        file >> data;
-
-        if (!data.contains("vertex_count") || !data.contains("motion_offsets") || !data.contains("vertex_trajectories")) {
-            MGlobal::displayError(MString("Cache loading failed: some fields not found"));
-            return false;
-        }
+    std::string error;
+    CacheRegistry::Handle cache = CacheRegistry::acquire(cachePath.asChar(), error);
+    if (!cache) {
+        MGlobal::displayError(MString("Cache loading failed: ") + error.c_str());
+        return false;
+    }
 
-        vertexCount = data["vertex_count"];
-        cacheFPS = data.value("baked_frame_rate", 24.0);
-        int startFrame = data.value("start_frame", 0);
-        int endFrame = data.value("end_frame", startFrame);
+    setSceneCache(cache);
+    lastCachePath = cachePath;
+    return true;
+}
 
-        int numFrames = endFrame - startFrame + 1;
+bool Smear::writeBinaryCache(const FrameStore& cache, const MString& cachePath)
+{
+    if (cache.empty()) {
+        MGlobal::displayError("No cache loaded to write.");
+        return false;
+    }
 
-        vertexCache.clear();
-        const json& vertex_trajectories = data["vertex_trajectories"];
-        for (const auto& [frameStr, positions] : vertex_trajectories.items())
-        {
-            int frame = std::stoi(frameStr);
-            int idx = frame - startFrame;
+    std::string error;
+    if (!cache.write(cachePath.asChar(), error)) {
+        MGlobal::displayError(MString("Cache writing failed: ") + error.c_str());
+        return false;
+    }
+    return true;
+}
 
-            if (vertexCache.find(idx) == vertexCache.end()) {
-                vertexCache.insert({ idx, FrameCache() });
-            }
+void Smear::clearVertexCache() {
+    setSceneCache(nullptr);
+    lastCachePath = "";
+}
 
-            FrameCache& fCache = vertexCache[idx];
-            fCache.positions.reserve(vertexCount);
+CacheRegistry::Handle Smear::resolveCache(const MString& cachePath)
+{
+    if (cachePath.length() == 0)
+        return sceneCache();
+
+    static std::mutex failedPathMutex;
+    static std::string failedPath;
+    std::string error;
+    CacheRegistry::Handle cache = CacheRegistry::acquire(cachePath.asChar(), error);
+    std::lock_guard<std::mutex> lock(failedPathMutex);
+    if (!cache) {
+        // Nodes resolve every evaluation, only report a bad path once
+        if (failedPath != cachePath.asChar())
+            MGlobal::displayError(MString("Cache loading failed: ") + error.c_str());
+        failedPath = cachePath.asChar();
+        return nullptr;
+    }
+    failedPath.clear();
+    return cache;
+}
 
-            for (const auto& pos : positions)
-                fCache.positions.emplace_back(pos[0], pos[1], pos[2]);
-        }
+CacheRegistry::Handle Smear::sceneCache()
+{
+    return std::atomic_load(&vertexCache);
+}
 
-        for (const auto& [frameStr, offsets] : data["motion_offsets"].items())
-        {
-            int frame = std::stoi(frameStr);
-            int idx = frame - startFrame;
+void Smear::setSceneCache(const CacheRegistry::Handle& cache)
+{
+    std::atomic_store(&vertexCache, cache);
+}
 
-            FrameCache& fCache = vertexCache[idx];
-            fCache.motionOffsets.setLength(offsets.size());
+double Smear::sceneFps()
+{
+    return MTime(1.0, MTime::kSeconds).as(MTime::uiUnit());
+}
 
-            for (unsigned i = 0; i < offsets.size(); ++i)
-            {
-                fCache.motionOffsets[i] = offsets[i];
-            }
-        }
+double Smear::cacheFrame(const MTime& time, const FrameStore& cache)
+{
+    if (std::abs(cache.fps() - sceneFps()) < 1e-6)
+        return time.as(MTime::uiUnit());
+    return time.as(MTime::kSeconds) * cache.fps();
+}
 
-        return true;
-    }
+MStatus Smear::watchTimeUnit()
+{
+    MStatus status;
+    CacheRegistry::setFrameRate(sceneFps());
+    timeUnitCallback = MEventMessage::addEventCallback("timeUnitChanged", timeUnitChanged, nullptr, &status);
+    if (!status)
+        timeUnitCallback = 0;
+    return status;
+}
 
-    catch (const std::exception& e)
-    {
-        MGlobal::displayError(MString("Cache loading failed: ") + e.what());
-        clearVertexCache();
-        return false;
-    }
+void Smear::unwatchTimeUnit()
+{
+    if (timeUnitCallback != 0)
+        MMessage::removeCallback(timeUnitCallback);
+    timeUnitCallback = 0;
 }
 
-void Smear::clearVertexCache() {
-    vertexCache.clear();
-    vertexCount = 0;
-    lastCachePath = "";
+void Smear::timeUnitChanged(void* clientData)
+{
+    const double fps = sceneFps();
+    if (fps == CacheRegistry::frameRate())
+        return;
+    CacheRegistry::setFrameRate(fps);
+
+    // Nodes with a cachePath pick up the reloaded cache when they next resolve it
+    if (sceneCache() && lastCachePath.length() > 0) {
+        std::string error;
+        CacheRegistry::Handle cache = CacheRegistry::acquire(lastCachePath.asChar(), error);
+        if (cache)
+            setSceneCache(cache);
+        else
+            MGlobal::displayError(MString("Cache resampling failed: ") + error.c_str());
+    }
+    MGlobal::executeCommandOnIdle("string $smearNodes[] = `ls -type SmearDeformerNode -type MotionLinesNode`; "
+        "if (size($smearNodes)) dgdirty $smearNodes;");
 }
 
 MPoint Smear::catmullRomInterpolate(const MPoint& p0, const MPoint& p1, const MPoint& p2, const MPoint& p3, float t) {
-    // SMEAR paper uses standard Catmull-Rom interpolation (Section 4.1)
-    const float t2 = t * t;
-    const float t3 = t2 * t;
-
-    // Basis matrix coefficients (as per original Catmull-Rom formulation)
-    const float a0 = -0.5f * t3 + t2 - 0.5f * t;
-    const float a1 = 1.5f * t3 - 2.5f * t2 + 1.0f;
-    const float a2 = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
-    const float a3 = 0.5f * t3 - 0.5f * t2;
+    // Same basis as the batched trajectory kernel, one point at a time
+    float w[4];
+    catmullRomWeights(t, w);
 
     // Combine control points
-    return p0 * a0 + p1 * a1 + p2 * a2 + p3 * a3;
+    return p0 * w[0] + p1 * w[1] + p2 * w[2] + p3 * w[3];
 }
\ No newline at end of file
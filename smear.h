@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <maya/MVector.h>
 #include <maya/MObject.h>
 #include <maya/MFnTransform.h>
@@ -9,12 +10,14 @@
 #include <maya/MPointArray.h>
 #include <maya/MDoubleArray.h>
 #include <maya/MDagPath.h>
+#include <maya/MObjectArray.h>
+#include <maya/MTime.h>
+#include <maya/MMessage.h>
 #include <vector>
 #include <unordered_map> 
 #include <fstream>  
-#include "json.hpp"
-
-using json = nlohmann::json;
+#include "cacheRegistry.h"
+#include "animCurveWatcher.h"
 
 using std::cout;
 using std::endl;
@@ -22,14 +25,27 @@ using std::endl;
 struct MotionOffsetsSimple {
     double startFrame;
     double endFrame;
-    std::vector<MDoubleArray> motionOffsets;  // 2D: motionOffsets[frame][vertex]
-    std::vector<MPointArray> vertexTrajectories; // Store per-vertex trajectory
-};
+    FrameStore frames;  // Per-frame vertex positions and motion offsets, frame 0 = startFrame
+    AnimCurveWatcher watcher;  // Key edits on the transform since the bake
+    double bakeMs = 0.0;  // How long the last bake or re-bake took
 
-struct FrameCache {
-    std::vector<MPoint> positions;     // Vertex world positions
-    MDoubleArray motionOffsets;        // Optional: scalar offset per vertex
-    bool loaded = false;
+    // Frames baked again since compute last took them, to refresh what it derived from them
+    int changedFirst = 0;
+    int changedLast = -1;
+    void markChanged(int first, int last)
+    {
+        if (first > last)
+            return;
+        changedFirst = changedFirst <= changedLast ? std::min(changedFirst, first) : first;
+        changedLast = std::max(changedLast, last);
+    }
+    void takeChanged(int& first, int& last)
+    {
+        first = changedFirst;
+        last = changedLast;
+        changedFirst = 0;
+        changedLast = -1;
+    }
 };
 
 struct BoneData {
@@ -46,29 +62,61 @@ private:
     // If this function does not compile, make sure to add "OpenMayaAnim.lib" in 
     // Project Properties -> Configuration Properties -> Linker -> Input -> Additional Dependencies
     static MStatus computeWorldTransformPerFrame(const MDagPath& transformPath, const double startFrame, const double endFrame, std::vector<MTransformationMatrix>& transformationMatrices);
-    static MStatus computeCentroidLocal(const MDagPath& shapePath, const MDagPath& transformPath, MVector& centroidLocal);
-    static MStatus computeCentroidTrajectory(double startFrame, double endFrame, const std::vector<MTransformationMatrix>& transformationMatrices, const MVector& centroidLocal, std::vector<MVector>& centroidPositions);
-    static MStatus computeCentroidVelocity(const std::vector<MVector>& centroidPositions, std::vector<MVector>& centroidVelocities);
+    // Local transform of every frame in [startFrame, endFrame], flattened row-major for computeSimpleOffsets
+    static MStatus computeFrameMatrices(const MDagPath& transformPath, double startFrame, double endFrame, std::vector<double>& matrices);
+    static MStatus getRestPositions(const MDagPath& shapePath, std::vector<float>& restPositions);
     static MStatus getTransformFromMesh(const MDagPath& shapePath, MDagPath& transformPath); 
-    static MStatus computeSignedDistanceToPlane(const MPoint& point, const MPoint& pointOnPlane, const MVector& planeNormal, double& signedDist);
-    static MStatus calculatePerFrameMotionOffsets(const MPointArray& vertexPositions, const MTransformationMatrix& transformationMatrix, const MPoint& centroid, const MVector& centroidVelocity, MDoubleArray& motionOffsets);
-    static MStatus getVerticesAtFrame(const MDagPath& shapePath, const MDagPath& transformPath, double frame, MPointArray& vertices);
+    // Fills the world-space positions of frames [firstIndex, lastIndex], resolving plugs once. Shapes with
+    // nothing time-dependent upstream transform restPositions instead of pulling outMesh each frame
+    static MStatus sampleWorldPositions(const MDagPath& shapePath, const MDagPath& transformPath, double startFrame, const float* restPositions, FrameStore& frames, int firstIndex, int lastIndex);
+    static bool isShapeTimeDependent(const MDagPath& shapePath);
 public:
     static MStatus computeMotionOffsetsSimple(const MDagPath& shapePath, const MDagPath& transformPath, MotionOffsetsSimple& motionOffsets);
+    // Re-bakes the frames whose transform changed in [firstIndex, lastIndex], which become the frames with new offsets
+    static MStatus rebakeMotionOffsetsSimple(const MDagPath& shapePath, const MDagPath& transformPath, MotionOffsetsSimple& motionOffsets, int& firstIndex, int& lastIndex);
+    // Bakes on first use, then only re-bakes what anim curve edits touched; node is prepared again on edits.
+    // Pulls the transform at other times, so only call it from the main thread between evaluations.
+    // firstIndex/lastIndex receive the frames with new offsets (an empty range when nothing changed)
+    static MStatus updateMotionOffsetsSimple(const MDagPath& shapePath, const MDagPath& transformPath, const MObject& node, MotionOffsetsSimple& motionOffsets, int& firstIndex, int& lastIndex);
+    static MStatus findAnimCurves(const MDagPath& transformPath, MObjectArray& curves);
     static MStatus extractAnimationFrameRange(const MDagPath& transformPath, double& startFrame, double& endFrame);
     static MStatus getDagPathsFromInputMesh(MObject inputMeshDataObj, const MPlug& inputMeshPlug, MDagPath& transformPath, MDagPath& shapePath);
 
     static bool isMeshArticulated(const MDagPath& meshPath);
     static MStatus getSkinClusterAndBones(const MDagPath& meshPath, MObject& skinClusterObj, MDagPathArray& influenceBones);
+    // Samples skinned positions and joints through MDGContext (the UI time is left alone),
+    // computes the articulated motion offsets and fills cache with [startFrame, endFrame]
+    static MStatus bakeArticulated(const MDagPath& meshPath, int startFrame, int endFrame, int smoothWindow, FrameStore& cache);
 
-    static std::unordered_map<int, FrameCache> vertexCache;
-    static double cacheFPS; 
-    static int vertexCount;
+    // Scene-wide cache from "loadCache" without -node, used by nodes whose cachePath is empty.
+    // Swapped atomically, an evaluation keeps the handle it resolved
+    static CacheRegistry::Handle sceneCache();
     static MString lastCachePath;
 
     static bool loadCache(const MString& cachePath);
+    static bool writeBinaryCache(const FrameStore& cache, const MString& cachePath);
     static void clearVertexCache();
+    // Cache a node samples: the one at its cachePath, or sceneCache() when that is empty
+    static CacheRegistry::Handle resolveCache(const MString& cachePath);
+
+    // Frames per second of the scene's time unit
+    static double sceneFps();
+    // Fractional frame number of cache at time. Caches are resampled to the scene rate on
+    // load, so this is the scene frame; other rates fall back to converting through seconds
+    static double cacheFrame(const MTime& time, const FrameStore& cache);
+    // Keeps the registry's frame rate on the scene's. When the time unit changes, caches are
+    // loaded again at the new rate and the nodes sampling them are dirtied
+    static MStatus watchTimeUnit();
+    static void unwatchTimeUnit();
+
+    static MPoint toPoint(const float* p) { return MPoint(p[0], p[1], p[2]); }
 
     // Interpolation helper
     static MPoint catmullRomInterpolate(const MPoint& p0, const MPoint& p1, const MPoint& p2, const MPoint& p3, float t);
+
+private:
+    static void timeUnitChanged(void* clientData);
+    static void setSceneCache(const CacheRegistry::Handle& cache);
+    static MCallbackId timeUnitCallback;
+    static CacheRegistry::Handle vertexCache;
 };
\ No newline at end of file
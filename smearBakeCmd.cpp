@@ -0,0 +1,125 @@
+#include "smearBakeCmd.h"
+#include "smear.h"
+#include "smearDeformerNode.h"
+#include "motionLinesNode.h"
+#include <maya/MAnimControl.h>
+#include <maya/MArgDatabase.h>
+#include <maya/MDagPath.h>
+#include <maya/MFnDependencyNode.h>
+#include <maya/MItDependencyGraph.h>
+#include <maya/MPlug.h>
+#include <maya/MSelectionList.h>
+#include <maya/MTime.h>
+#include <filesystem>
+
+static const char* kStartFlag = "-s";
+static const char* kStartFlagLong = "-startFrame";
+static const char* kEndFlag = "-e";
+static const char* kEndFlagLong = "-endFrame";
+static const char* kOutputFlag = "-o";
+static const char* kOutputFlagLong = "-output";
+static const char* kWindowFlag = "-w";
+static const char* kWindowFlagLong = "-smoothWindow";
+static const char* kLoadFlag = "-l";
+static const char* kLoadFlagLong = "-load";
+
+MSyntax SmearBakeCmd::newSyntax()
+{
+    MSyntax syntax;
+    syntax.addFlag(kStartFlag, kStartFlagLong, MSyntax::kLong);
+    syntax.addFlag(kEndFlag, kEndFlagLong, MSyntax::kLong);
+    syntax.addFlag(kOutputFlag, kOutputFlagLong, MSyntax::kString);
+    syntax.addFlag(kWindowFlag, kWindowFlagLong, MSyntax::kLong);
+    syntax.addFlag(kLoadFlag, kLoadFlagLong);
+    syntax.useSelectionAsDefault(true);
+    syntax.setObjectType(MSyntax::kSelectionList, 1, 1);
+    return syntax;
+}
+
+// Same location and name vertex_cache_tool.py uses: <cwd>/cache/<shape>_cache.smc, where
+// <shape> is the shortest unique name (what listRelatives returns) with | and : replaced by _
+static MString defaultCachePath(const MDagPath& shapePath)
+{
+    std::filesystem::path cacheDir = std::filesystem::current_path() / "cache";
+    std::error_code error;
+    std::filesystem::create_directories(cacheDir, error);
+
+    MString safeName = shapePath.partialPathName();
+    safeName.substitute("|", "_");
+    safeName.substitute(":", "_");
+    return MString(cacheDir.generic_u8string().c_str()) + "/" + safeName + "_cache.smc";
+}
+
+// Points every SmearDeformerNode / MotionLinesNode around the mesh at the cache
+static void bindSmearNodes(const MDagPath& shapePath, const MString& cachePath)
+{
+    const MItDependencyGraph::Direction directions[] = { MItDependencyGraph::kUpstream, MItDependencyGraph::kDownstream };
+    for (MItDependencyGraph::Direction direction : directions) {
+        MObject shape = shapePath.node();
+        MItDependencyGraph it(shape, MFn::kInvalid, direction, MItDependencyGraph::kDepthFirst, MItDependencyGraph::kNodeLevel);
+        for (; !it.isDone(); it.next()) {
+            MFnDependencyNode nodeFn(it.currentItem());
+            if (nodeFn.typeId() != SmearDeformerNode::id && nodeFn.typeId() != MotionLinesNode::id)
+                continue;
+            MPlug cachePathPlug = nodeFn.findPlug("cachePath", true);
+            if (!cachePathPlug.isNull())
+                cachePathPlug.setString(cachePath);
+        }
+    }
+}
+
+MStatus SmearBakeCmd::doIt(const MArgList& args)
+{
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    if (!status) {
+        MGlobal::displayError("Usage: smearBake [-startFrame <f>] [-endFrame <f>] [-output <path.smc>] [-smoothWindow <n>] [-load] <mesh>");
+        return MS::kFailure;
+    }
+
+    MSelectionList objects;
+    argData.getObjects(objects);
+    MDagPath shapePath;
+    status = objects.getDagPath(0, shapePath);
+    if (!status || !shapePath.extendToShape() || !shapePath.hasFn(MFn::kMesh)) {
+        MGlobal::displayError("smearBake: select or name a skinned mesh.");
+        return MS::kFailure;
+    }
+
+    int startFrame = static_cast<int>(MAnimControl::minTime().as(MTime::uiUnit()));
+    int endFrame = static_cast<int>(MAnimControl::maxTime().as(MTime::uiUnit()));
+    int smoothWindow = 2;
+    if (argData.isFlagSet(kStartFlag))
+        argData.getFlagArgument(kStartFlag, 0, startFrame);
+    if (argData.isFlagSet(kEndFlag))
+        argData.getFlagArgument(kEndFlag, 0, endFrame);
+    if (argData.isFlagSet(kWindowFlag))
+        argData.getFlagArgument(kWindowFlag, 0, smoothWindow);
+
+    MString outputPath;
+    if (argData.isFlagSet(kOutputFlag))
+        argData.getFlagArgument(kOutputFlag, 0, outputPath);
+    else
+        outputPath = defaultCachePath(shapePath);
+
+    FrameStore cache;
+    status = Smear::bakeArticulated(shapePath, startFrame, endFrame, smoothWindow, cache);
+    if (!status)
+        return status;
+
+    // Anything still mapping the old file must let go before it is rewritten
+    CacheRegistry::invalidate(outputPath.asChar());
+    if (Smear::lastCachePath == outputPath)
+        Smear::clearVertexCache();
+    if (!Smear::writeBinaryCache(cache, outputPath))
+        return MS::kFailure;
+
+    MGlobal::displayInfo("[SMEARin] Baked " + shapePath.partialPathName() + " frames " + startFrame + "-" + endFrame
+        + " to " + outputPath);
+
+    if (argData.isFlagSet(kLoadFlag))
+        bindSmearNodes(shapePath, outputPath);
+
+    setResult(outputPath);
+    return MS::kSuccess;
+}
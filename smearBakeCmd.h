@@ -0,0 +1,21 @@
+#pragma once
+#include <maya/MPxCommand.h>
+#include <maya/MArgList.h>
+#include <maya/MGlobal.h>
+#include <maya/MSyntax.h>
+
+/*
+	smearBake pCharacterShape;                                    // playback range, cache/<mesh>_cache.smc
+	smearBake -startFrame 1 -endFrame 300 -output "path/to/characterA.smc" -load pCharacter;
+
+	Bakes an articulated (skinned) mesh natively and writes a binary cache.
+	Returns the path of the written cache. With -load the cache is also bound to
+	the mesh's SmearDeformerNode / MotionLinesNode, like loadCache -node.
+*/
+
+class SmearBakeCmd : public MPxCommand {
+public:
+    static void* creator() { return new SmearBakeCmd(); }
+    static MSyntax newSyntax();
+    MStatus doIt(const MArgList& args) override;
+};
@@ -18,6 +18,8 @@ public:
 	static  void* creator();
 	static  MStatus initialize();
 	MStatus compute(const MPlug& plug, MDataBlock& data) override;
+	// Holds no state, its attributes are read by the nodes it connects to
+	SchedulingType schedulingType() const override { return kParallel; }
 
     static MTypeId id;  // Unique node ID
 
@@ -8,14 +8,21 @@
 #include <maya/MStatus.h>
 #include <maya/MGlobal.h>
 #include <maya/MDagPathArray.h>
+#include <maya/MIntArray.h>
 #include <maya/MFnDependencyNode.h>
 #include <maya/MItDependencyGraph.h>
 #include <math.h>
+#include <algorithm>
 #include <maya/MPoint.h>
 #include <maya/MTimeArray.h>
 #include <maya/MFnSkinCluster.h>
 #include <maya/MFnSingleIndexedComponent.h>
 #include <maya/MAnimControl.h>
+#include <maya/MMessage.h>
+#include "catmullRom.h"
+#include "smearMotion.h"
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
 #define McheckErr(stat, msg)        \
     if (MS::kSuccess != stat) {     \
@@ -23,6 +30,9 @@
         return MS::kFailure;        \
     }
 
+// Vertices per parallel task; large enough that scheduling cost stays negligible
+static const int kDeformGrainSize = 2048;
+
 MTypeId SmearDeformerNode::id(0x98530); // Random id 
 MObject SmearDeformerNode::time;
 MObject SmearDeformerNode::elongationSmoothWindowSize;
@@ -31,16 +41,35 @@ MObject SmearDeformerNode::aelongationStrengthPast;
 MObject SmearDeformerNode::aelongationStrengthFuture; 
 MObject SmearDeformerNode::aApplyElongation;
 MObject SmearDeformerNode::aCacheLoaded;
+MObject SmearDeformerNode::aCachePath;
+MObject SmearDeformerNode::aSubframeSamples;
+MObject SmearDeformerNode::aShutterOpen;
+MObject SmearDeformerNode::aShutterClose;
+StatsAttributes SmearDeformerNode::statsAttributes;
 
 // Message attribute for connecting to the control node.
 MObject SmearDeformerNode::inputControlMsg;
 
 SmearDeformerNode::SmearDeformerNode():
-    motionOffsets(), motionOffsetsBaked(false), skinDataBaked(false)
+    motionOffsets(), skinDataBaked(false), m_inputCallback(0)
 {}
 
 SmearDeformerNode::~SmearDeformerNode()
-{}
+{
+    if (m_inputCallback != 0)
+        MMessage::removeCallback(m_inputCallback);
+}
+
+void SmearDeformerNode::postConstructor()
+{
+    MStatus status;
+    MObject node = thisMObject();
+    MCallbackId id = MNodeMessage::addAttributeChangedCallback(node, inputConnectionChanged, this, &status);
+    if (status)
+        m_inputCallback = id;
+    else
+        MGlobal::displayWarning("SmearDeformerNode: could not watch input connections, reconnected meshes will not be picked up");
+}
 
 void* SmearDeformerNode::creator()
 {
@@ -59,6 +88,11 @@ MStatus SmearDeformerNode::initialize()
     CHECK_MSTATUS_AND_RETURN_IT(status);
     addAttribute(aCacheLoaded);
 
+    // Cache this deformer samples; empty uses the scene-wide cache from loadCache
+    aCachePath = typedAttr.create("cachePath", "cp", MFnData::kString, MObject::kNullObj, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    addAttribute(aCachePath);
+
     // Time attribute 
     time = unitAttr.create("time", "tm", MFnUnitAttribute::kTime, 0.0);
     addAttribute(time);
@@ -89,13 +123,29 @@ MStatus SmearDeformerNode::initialize()
     numAttr.setKeyable(false);
     addAttribute(aApplyElongation);
 
+    // Motion-blur sub-samples per frame, from shutterOpen to shutterClose around each frame and
+    // evaluated together on the first one; 1 evaluates each time on its own
+    aSubframeSamples = numAttr.create("subframeSamples", "sfs", MFnNumericData::kInt, 1);
+    numAttr.setMin(1);
+    numAttr.setMax(16);
+    addAttribute(aSubframeSamples);
+
+    // The renderer's shutter, in frames relative to the frame; times off its grid are evaluated on their own
+    aShutterOpen = numAttr.create("shutterOpen", "sho", MFnNumericData::kDouble, -0.25);
+    addAttribute(aShutterOpen);
+    aShutterClose = numAttr.create("shutterClose", "shc", MFnNumericData::kDouble, 0.25);
+    addAttribute(aShutterClose);
+
     // Create the message attribute that will connect this deformer to the control node.
     inputControlMsg = mAttr.create("inputControlMessage", "icm", &status);
     mAttr.setStorable(false);
     mAttr.setKeyable(false);
     addAttribute(inputControlMsg);
 
-    
+    // Read-only profiling outputs, updated after every deform
+    status = statsAttributes.add();
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+
     return MS::kSuccess;
 }
 
@@ -105,87 +155,82 @@ MStatus SmearDeformerNode::deformSimple(MDataBlock& block, MItGeometry& iter, MD
     MDataHandle timeDataHandle = block.inputValue(time, &status);
     McheckErr(status, "Failed to obtain data handle for time input");
     MTime currentTime = timeDataHandle.asTime();
-    double currentFrame = currentTime.as(MTime::kFilm);
-
-    // +++ Compute motion offsets using Smear functions +++
-    if (!motionOffsetsBaked) {
-        status = Smear::computeMotionOffsetsSimple(meshPath, transformPath, motionOffsets);
-        McheckErr(status, "Failed to compute motion offsets");
-        motionOffsetsBaked = true;
+    // Baked in the scene's time unit, so the scene frame indexes the bake
+    double currentFrame = currentTime.as(MTime::uiUnit());
+
+    // Motion offsets are baked by prepare(); a bake in another time unit needs another one
+    const FrameStore& frames = motionOffsets.frames;
+    if (!frames.empty() && std::abs(frames.fps() - Smear::sceneFps()) > 1e-6)
+        prepareOrRequest(thisMObject());
+    if (frames.empty())
+        return MS::kSuccess;
+    // Frames prepare() baked again since the last evaluation
+    int firstChanged, lastChanged;
+    motionOffsets.takeChanged(firstChanged, lastChanged);
+    m_stats.bakeMs = motionOffsets.bakeMs;
+    bool rebuilt = firstChanged <= lastChanged;
+
+    {
+        // Smoothed offsets for the whole clip are built once per window, each frame is a lookup
+        SmearProfilingScope scope("Smooth offsets", m_stats.smoothMs);
+        rebuilt |= smoothedOffsetCache.refresh(frames, firstChanged, lastChanged);
+        rebuilt |= smoothedOffsetCache.update(frames, N);
     }
+    m_stats.countLookup(!rebuilt);
+    if (rebuilt)
+        m_subframes.invalidate();
 
-    int frameIndex = static_cast<int>(currentFrame - motionOffsets.startFrame);
-
-    if (frameIndex < 0 || frameIndex >= motionOffsets.motionOffsets.size()) {
+    // Fractional during motion-blur renders; the fraction carries into the spline parameter
+    const double frameTime = currentFrame - motionOffsets.startFrame;
+    if (!frames.hasFrame(static_cast<int>(std::floor(frameTime)))) {
         return MS::kSuccess; // Skip invalid frames
     }
-    const MDoubleArray& offsets = motionOffsets.motionOffsets[frameIndex];
-    const std::vector<MPointArray>& trajectories = motionOffsets.vertexTrajectories;
-    const int numFrames = trajectories.size();
-
-    std::vector<double> smoothedOffsets(offsets.length(), 0.0);
-
-    // Precompute smoothed offsets for all vertices
-    for (int vertIdx = 0; vertIdx < offsets.length(); ++vertIdx) {
-        double totalWeight = 0.0;
-        double smoothed = 0.0;
-
-        for (int n = -N; n <= N; ++n) {
-            const int frame = frameIndex + n;
-
-            // Skip out-of-bounds frames
-            if (frame < 0 || frame >= motionOffsets.motionOffsets.size()) continue;
-
-            // Calculate weight
-            const double normalized = std::abs(n) / static_cast<double>(N + 1);
-            const double weight = std::pow(1.0 - std::pow(normalized, 2.0), 2.0);
-
-            smoothed += motionOffsets.motionOffsets[frame][vertIdx] * weight;
-            totalWeight += weight;
+    const int numVertices = frames.vertexCount();
+
+    // Read every point once, deform them in parallel and write them back in one call
+    MPointArray points;
+    status = iter.allPositions(points);
+    McheckErr(status, "Failed to read deformed points");
+    const int numPoints = static_cast<int>(points.length());
+
+    // The iterator may only cover part of the mesh; map point -> vertex when it does
+    std::vector<int> pointIds, sampleVertices;
+    pointIds.reserve(numPoints);
+    sampleVertices.reserve(numPoints);
+    if (numPoints == numVertices) {
+        for (int i = 0; i < numPoints; ++i) {
+            pointIds.push_back(i);
+            sampleVertices.push_back(i);
         }
-
-        // Store final smoothed offset
-        smoothedOffsets[vertIdx] = totalWeight > 0.0 ? smoothed / totalWeight : offsets[vertIdx];
     }
-
-
-    MPoint point;
-    for (; !iter.isDone(); iter.next()) {
-        const int vertIdx = iter.index();
-
-        if (frameIndex < 0 || frameIndex >= motionOffsets.motionOffsets.size()) {
-            continue;
+    else {
+        int i = 0;
+        for (iter.reset(); !iter.isDone(); iter.next(), ++i) {
+            const int vertIdx = iter.index();
+            if (vertIdx < 0 || vertIdx >= numVertices)
+                continue;
+            pointIds.push_back(i);
+            sampleVertices.push_back(vertIdx);
         }
-
-        // Get motion offset and apply strength
-        double offset = smoothedOffsets[vertIdx];
-
-        // Calculate the strength factor based on motion offset value 
-        double t1 = (offset + 1.) / 2.; // remaps motion offset from [-1, 1] to [0, 1] 
-        double interpolatedStrength = (1.0 - t1) * elongationStrengthPast + t1 * elongationStrengthFuture;
-
-        const double beta = offset * interpolatedStrength;
-
-        const int frameOffset = static_cast<int>(floor(beta));
-        const double t2 = beta - frameOffset;
-
-        const int baseFrame = frameIndex + frameOffset;
-        // Clamp frame indices
-        const int f0 = std::max(0, std::min(numFrames - 1, baseFrame - 1));
-        const int f1 = std::max(0, std::min(numFrames - 1, baseFrame));
-        const int f2 = std::max(0, std::min(numFrames - 1, baseFrame + 1));
-        const int f3 = std::max(0, std::min(numFrames - 1, baseFrame + 2));
-
-        // Get trajectory points
-        const MPoint& p0 = trajectories[f0][vertIdx];
-        const MPoint& p1 = trajectories[f1][vertIdx];
-        const MPoint& p2 = trajectories[f2][vertIdx];
-        const MPoint& p3 = trajectories[f3][vertIdx];
-
-        MPoint interpolated = Smear::catmullRomInterpolate(p0, p1, p2, p3, t2);
-
-        iter.setPosition(interpolated);
     }
+    m_stats.verticesProcessed = numPoints;
+
+    SmearProfilingScope scope("Interpolate trajectories", m_stats.interpolateMs);
+    // Strength blended by the smoothed offset picks the trajectory segment
+    const ElongationParams params{ elongationStrengthPast, elongationStrengthFuture, ElongationMode::Simple };
+    std::vector<float> scratch;
+    const float* sampled = sampleElongatedAt(frames, smoothedOffsetCache, params, sampleVertices, frameTime, scratch);
+    m_stats.residentBytes = frames.residentBytes() + smoothedOffsetCache.residentBytes() + m_subframes.residentBytes();
+
+    const int count = static_cast<int>(pointIds.size());
+    tbb::parallel_for(tbb::blocked_range<int>(0, count, kDeformGrainSize),
+        [&](const tbb::blocked_range<int>& range) {
+        for (int k = range.begin(); k != range.end(); ++k)
+            points[pointIds[k]] = Smear::toPoint(&sampled[k * 3]);
+    });
+
+    status = iter.setAllPositions(points);
+    McheckErr(status, "Failed to write deformed points");
     return MStatus::kSuccess;
 }
 
@@ -198,63 +243,94 @@ MStatus SmearDeformerNode::deformArticulated(MDataBlock& block, MItGeometry& ite
     McheckErr(status, "Failed to obtain data handle for time input");
     MTime currentTime = timeDataHandle.asTime();
 
-    // Maya seems to always evaluate deformer node at 24 fps, 
-    // So if the viewport is set to 30 fps,
-    // and the viewport's current frame is 30 
-    // frameD will be 24. (frame 30 / 30 fps = 1 sec; 1 sec * 24 fps = frame 24)
-    const double deformerEvaluationFPS = 24.0; 
-    double frameD = currentTime.as(MTime::kFilm); 
-    double sampleFrameD = frameD * Smear::cacheFPS / deformerEvaluationFPS; 
-    int sampleFrame = static_cast<int>(sampleFrameD);
-
-    // assume Smear::vertexCache[f] corresponds to Maya frame f <- NOT TRUE ANYMORE SINCE WE ARE USING VECTOR INSTEAD OF MAP 
-    if (sampleFrame < 0 || sampleFrame >= (int)Smear::vertexCache.size())
+    CacheRegistry::Handle resolved = Smear::resolveCache(block.inputValue(aCachePath).asString());
+    if (!resolved)
+        return MS::kFailure;
+    m_stats.countLookup(resolved == m_cache);
+    if (resolved != m_cache)
+        m_subframes.invalidate();
+    m_cache = resolved;
+    const FrameStore& source = *m_cache;
+    m_stats.residentBytes = source.residentBytes();
+    // The cache is at the scene rate, so the scene frame indexes it
+    const double sampleFrameD = Smear::cacheFrame(currentTime, source);
+    const int sampleFrameNumber = static_cast<int>(std::floor(sampleFrameD));
+    int sampleFrame = source.frameIndex(sampleFrameNumber);
+
+    if (!source.hasFrame(sampleFrame))
         return MS::kFailure;
-
-    const FrameCache& fc = Smear::vertexCache[sampleFrame];
-
-    // references to the cached data
-    const auto& basePos = fc.positions;      // vector<MPoint>
-    const auto& deltas = fc.motionOffsets;  // MDoubleArray
 
     // 2) artist parameters (read earlier in deform() and stored in members)
     double sPast = elongationStrengthPast;
     double sFut = elongationStrengthFuture;
 
-    // 3) for Catmull‑Rom we need positions at f−1,f,f+1,f+2
-    auto getPos = [&](int fIdx, int vid)->MPoint {
-        // clamp to valid range
-        fIdx = std::clamp(fIdx, 0, (int)Smear::vertexCache.size() - 1);
-        return Smear::vertexCache[fIdx].positions[vid];
-        };
-
-    //// 4) now for each vertex
-    for (; !iter.isDone(); iter.next()) {
+    // Points sample up to the strength away from sampleFrame, plus the spline's neighbours
+    // and the frame after it that sub-frame times blend towards
+    const int reach = static_cast<int>(std::ceil(std::max(sPast, sFut))) + 3;
+    if (MAnimControl::isPlaying())
+        m_prefetcher.request(m_cache, sampleFrame, reach);
+    else
+        m_prefetcher.reset();
+
+    // Compressed caches are sampled from the frames decoded around sampleFrame
+    bool decoded = false;
+    const FrameStore& cache = m_window.view(m_cache, sampleFrame - reach, sampleFrame + reach, &decoded);
+    sampleFrame = cache.frameIndex(sampleFrameNumber);
+    if (&cache != &source)
+        m_stats.residentBytes += cache.residentBytes();
+    if (decoded)
+        m_subframes.invalidate();
+    m_articulatedOffsets.update(cache, 0);
+    const double frameTime = sampleFrame + (sampleFrameD - sampleFrameNumber);
+
+    // 3) work out which trajectory segment each point samples, Catmull‑Rom needs f−1,f,f+1,f+2
+    MPointArray points;
+    status = iter.allPositions(points);
+    McheckErr(status, "Failed to read deformed points");
+
+    SmearProfilingScope scope("Interpolate trajectories", m_stats.interpolateMs);
+    std::vector<int> pointIds, sampleVertices;
+    for (int i = 0; !iter.isDone(); iter.next(), ++i) {
         int vid = iter.index();
-        double delta = deltas[vid];
+        if (vid < 0 || vid >= cache.vertexCount())
+            continue;
+        pointIds.push_back(i);
+        sampleVertices.push_back(vid);
+    }
 
-        // compute the “baked” displacement amount
-        double beta = delta *(delta < 0 ? sPast : sFut);
+    // 4) evaluate every spline in one batch and write the points back
+    //β∈[−1,1] → if β≥0 we move toward next frame, else toward prev
+    const ElongationParams params{ sPast, sFut, ElongationMode::Articulated };
+    std::vector<float> scratch;
+    const float* sampled = sampleElongatedAt(cache, m_articulatedOffsets, params, sampleVertices, frameTime, scratch);
+    m_stats.residentBytes += m_subframes.residentBytes();
 
-        // determine which segment of the trajectory to sample
-         //β∈[−1,1] → if β≥0 we move toward next frame, else toward prev
-        int   baseFrame = sampleFrame + (int)std::floor(beta);
-        double u = beta - std::floor(beta);
+    const int count = static_cast<int>(pointIds.size());
+    m_stats.verticesProcessed = count;
+    for (int k = 0; k < count; ++k)
+        points[pointIds[k]] = Smear::toPoint(&sampled[k * 3]);
 
-        // control points for Catmull‑Rom: p0,p1,p2,p3
-        MPoint p0 = getPos(baseFrame - 1, vid);
-        MPoint p1 = getPos(baseFrame, vid);
-        MPoint p2 = getPos(baseFrame + 1, vid);
-        MPoint p3 = getPos(baseFrame + 2, vid);
+    status = iter.setAllPositions(points);
+    McheckErr(status, "Failed to write deformed points");
 
-        // evaluate spline
-        MPoint newP = Smear::catmullRomInterpolate(p0, p1, p2, p3, (float)u);
+    return MS::kSuccess;
+}
 
-        // set the vertex
-        iter.setPosition(newP);        
+const float* SmearDeformerNode::sampleElongatedAt(const FrameStore& frames, const SmoothedOffsets& offsets,
+    const ElongationParams& params, const std::vector<int>& vertexIds, double frameTime, std::vector<float>& scratch)
+{
+    const int count = static_cast<int>(vertexIds.size());
+    if (shutter.samples > 1) {
+        const float* positions = m_subframes.positions(frames, offsets, params, vertexIds.data(), count, frameTime, shutter);
+        if (positions)
+            return positions;
     }
-
-    return MS::kSuccess;
+    else {
+        m_subframes.invalidate();
+    }
+    scratch.resize(static_cast<size_t>(count) * 3);
+    sampleElongated(frames, offsets, params, vertexIds.data(), count, &frameTime, 1, scratch.data());
+    return scratch.data();
 }
 
 
@@ -270,52 +346,84 @@ MStatus SmearDeformerNode::deform(MDataBlock& block, MItGeometry& iter, const MM
     }
 
     // 1. Get current mesh information
-    MDagPath meshPath, transformPath;
-    getDagPaths(block, iter, multiIndex, meshPath, transformPath);
-    MString meshName = meshPath.fullPathName();
+    if (!hasPrepared())
+        prepareOrRequest(thisMObject());
+    // Nothing to smear until the input resolves to a mesh; leave the points as they are
+    auto input = m_inputPaths.find(multiIndex);
+    if (input == m_inputPaths.end())
+        return MS::kSuccess;
+    MDagPath meshPath = input->second.meshPath;
+    MDagPath transformPath = input->second.transformPath;
 
     // 3. Get deformation parameters
     elongationStrengthPast = block.inputValue(aelongationStrengthPast).asDouble();
     elongationStrengthFuture = block.inputValue(aelongationStrengthFuture).asDouble();
     smoothingEnabled = block.inputValue(smoothEnabled).asBool();
     N = smoothingEnabled ? block.inputValue(elongationSmoothWindowSize).asInt() : 0;
+    shutter.samples = block.inputValue(aSubframeSamples).asInt();
+    shutter.open = block.inputValue(aShutterOpen).asDouble();
+    shutter.close = block.inputValue(aShutterClose).asDouble();
 
 
     // 4. Perform deformation
-    if (Smear::isMeshArticulated(meshPath)) {
-        deformArticulated(block, iter, meshPath);
-    }
-    else {
-        deformSimple(block, iter, meshPath, transformPath);
+    {
+        SmearProfilingScope scope("Deform", m_stats.evaluateMs, MProfiler::kColorE_L2);
+        if (input->second.articulated) {
+            deformArticulated(block, iter, meshPath);
+        }
+        else {
+            deformSimple(block, iter, meshPath, transformPath);
+        }
     }
+    ++m_stats.evaluations;
+    statsAttributes.write(block, m_stats);
 
     return MS::kSuccess();
 }
 
-MStatus SmearDeformerNode::getDagPaths(MDataBlock& block, MItGeometry iter, unsigned int multiIndex, MDagPath& meshPath, MDagPath& transformPath) 
+MStatus SmearDeformerNode::prepare()
 {
     MStatus status;
-    MArrayDataHandle hInputArray = block.inputArrayValue(input, &status);
-    if (!status) {
-        MGlobal::displayError("Failed to get input geometry array: " + MString(status.errorString()));
-        return status;
-    }
+    MObject node = thisMObject();
+    MPlug inputPlug(node, input);
+    MIntArray indices;
+    inputPlug.getExistingArrayAttributeIndices(indices, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
 
-    // Jump to the element corresponding to the current multiIndex.
-    status = hInputArray.jumpToElement(multiIndex);
-    if (!status) {
-        MGlobal::displayError("Failed to jump to input element.");
-        return status;
-    }
+    m_inputPaths.clear();
+    bool baked = false;
+    for (unsigned int i = 0; i < indices.length(); ++i) {
+        const unsigned int multiIndex = static_cast<unsigned int>(indices[i]);
+        InputPaths paths;
+        if (!resolveDagPaths(multiIndex, paths.meshPath, paths.transformPath))
+            continue;
+        paths.articulated = m_skinBinding.isArticulated(paths.meshPath, node);
+        m_inputPaths[multiIndex] = paths;
+        if (paths.articulated || baked)
+            continue;
 
-    // Get the geometry data.
-    MDataHandle hInput = hInputArray.inputValue(&status);
-    if (!status) {
-        MGlobal::displayError("Failed to get the input value.");
-        return status;
+        // Baked once; afterwards key edits only re-bake the frames they touched
+        int firstChanged, lastChanged;
+        status = Smear::updateMotionOffsetsSimple(paths.meshPath, paths.transformPath, node, motionOffsets, firstChanged, lastChanged);
+        McheckErr(status, "Failed to compute motion offsets");
+        motionOffsets.markChanged(firstChanged, lastChanged);
+        baked = true;
     }
-    MDataHandle hGeom = hInput.child(inputGeom);
-    MObject geomObj = hGeom.data();
+    return MS::kSuccess;
+}
+
+void SmearDeformerNode::inputConnectionChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData)
+{
+    if (!(msg & (MNodeMessage::kConnectionMade | MNodeMessage::kConnectionBroken | MNodeMessage::kAttributeArrayRemoved)))
+        return;
+    MObject attribute = plug.attribute();
+    if (attribute == inputGeom || attribute == input)
+        PreparedNode::request(static_cast<SmearDeformerNode*>(clientData)->thisMObject());
+}
+
+MStatus SmearDeformerNode::resolveDagPaths(unsigned int multiIndex, MDagPath& meshPath, MDagPath& transformPath)
+{
+    MStatus status;
     // 2. Get connected mesh node from input plug
     MPlug inputPlug(thisMObject(), input);  // input[] plug
     MPlug inputElementPlug = inputPlug.elementByLogicalIndex(multiIndex, &status);
@@ -327,6 +435,8 @@ MStatus SmearDeformerNode::getDagPaths(MDataBlock& block, MItGeometry iter, unsi
     MPlugArray connections;
     geomPlug.connectedTo(connections, true, false, &status);  // look upstream.
     CHECK_MSTATUS_AND_RETURN_IT(status);
+    if (connections.length() == 0)
+        return MS::kFailure;
 
     MPlug srcPlug = connections[0];
     MObject meshNode = srcPlug.node();
@@ -364,42 +474,29 @@ MStatus SmearDeformerNode::getDagPaths(MDataBlock& block, MItGeometry iter, unsi
 
 // General deformation application using offsets + trajectories
 void SmearDeformerNode::applyDeformation(MItGeometry& iter, int frameIndex) {
-    const int numFrames = static_cast<int>(motionOffsets.vertexTrajectories.size());
-    const MDoubleArray& offsets = motionOffsets.motionOffsets[frameIndex];
-
-    std::vector<double> finalOffsets(offsets.length());
-    for (int i = 0; i < offsets.length(); ++i) {
-        double sum = 0.0, total = 0.0;
-        for (int j = -N; j <= N; ++j) {
-            int idx = frameIndex + j;
-            if (idx < 0 || idx >= motionOffsets.motionOffsets.size()) continue;
-            double w = std::pow(1.0 - std::pow(std::abs(j) / double(N + 1), 2.0), 2.0);
-            sum += motionOffsets.motionOffsets[idx][i] * w;
-            total += w;
-        }
-        finalOffsets[i] = (total > 0.0) ? sum / total : offsets[i];
-    }
+    const FrameStore& frames = motionOffsets.frames;
+    smoothedOffsetCache.update(frames, N);
+    const float* finalOffsets = smoothedOffsetCache.offsets(frameIndex);
 
-    for (; !iter.isDone(); iter.next()) {
+    std::vector<int> pointIds, sampleVertices, baseFrames;
+    std::vector<float> sampleT;
+    for (int i = 0; !iter.isDone(); iter.next(), ++i) {
         int idx = iter.index();
-        double offset = finalOffsets[idx];
-        double t = (offset + 1.0) / 2.0;
-        double strength = (1.0 - t) * elongationStrengthPast + t * elongationStrengthFuture;
-        double beta = offset * strength;
-
-        int baseFrame = frameIndex + int(floor(beta));
-        double localT = beta - floor(beta);
+        const ElongationSample sample = elongationSample(finalOffsets[idx], elongationStrengthPast, elongationStrengthFuture, frameIndex);
 
-        int f0 = std::clamp(baseFrame - 1, 0, numFrames - 1);
-        int f1 = std::clamp(baseFrame, 0, numFrames - 1);
-        int f2 = std::clamp(baseFrame + 1, 0, numFrames - 1);
-        int f3 = std::clamp(baseFrame + 2, 0, numFrames - 1);
+        pointIds.push_back(i);
+        sampleVertices.push_back(idx);
+        baseFrames.push_back(sample.baseFrame);
+        sampleT.push_back(sample.t);
+    }
 
-        const MPoint& p0 = motionOffsets.vertexTrajectories[f0][idx];
-        const MPoint& p1 = motionOffsets.vertexTrajectories[f1][idx];
-        const MPoint& p2 = motionOffsets.vertexTrajectories[f2][idx];
-        const MPoint& p3 = motionOffsets.vertexTrajectories[f3][idx];
+    const int count = static_cast<int>(pointIds.size());
+    std::vector<float> sampled(count * 3);
+    sampleTrajectories(frames, sampleVertices.data(), baseFrames.data(), sampleT.data(), count, sampled.data());
 
-        iter.setPosition(Smear::catmullRomInterpolate(p0, p1, p2, p3, localT));
-    }
+    MPointArray points;
+    iter.allPositions(points);
+    for (int k = 0; k < count; ++k)
+        points[pointIds[k]] = Smear::toPoint(&sampled[k * 3]);
+    iter.setAllPositions(points);
 }
\ No newline at end of file
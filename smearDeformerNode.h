@@ -5,8 +5,17 @@
 #include <maya/MTypeId.h>
 #include <maya/MDagPathArray.h>
 #include <maya/MVector.h>
+#include <maya/MNodeMessage.h>
+#include <atomic>
+#include <unordered_map>
 #include <vector>
 #include "smear.h"
+#include "smoothedOffsets.h"
+#include "subframeSampling.h"
+#include "framePrefetcher.h"
+#include "smearStats.h"
+#include "skinBinding.h"
+#include "nodePreparation.h"
 
 
 /*
@@ -19,7 +28,7 @@ struct InfluenceData {
     float weight;
 };
 
-class SmearDeformerNode : public MPxDeformerNode
+class SmearDeformerNode : public MPxDeformerNode, public PreparedNode
 {
 public:
     static MTypeId id;
@@ -33,6 +42,11 @@ public:
     static MObject aelongationStrengthFuture; 
     static MObject aApplyElongation; 
     static MObject aCacheLoaded;
+    static MObject aCachePath;
+    static MObject aSubframeSamples;
+    static MObject aShutterOpen;
+    static MObject aShutterClose;
+    static StatsAttributes statsAttributes;
 
 
     // Message attribute for connecting the control node.
@@ -40,6 +54,9 @@ public:
 
     SmearDeformerNode();
     ~SmearDeformerNode();
+    void postConstructor() override;
+    // deform only reads what prepare() left behind
+    SchedulingType schedulingType() const override { return PreparedNode::schedulingType(); }
     
     // Node lifecycle
     static void* creator();
@@ -53,15 +70,47 @@ public:
     void applyDeformation(MItGeometry& iter, int frameIndex);
     MStatus deformSimple(MDataBlock& block, MItGeometry& iter, MDagPath& meshPath, MDagPath& transformPath);
     MStatus deformArticulated(MDataBlock& block, MItGeometry& iter, MDagPath& meshPath);
-    MStatus getDagPaths(MDataBlock& block, MItGeometry iter, unsigned int multiIndex, MDagPath& meshPath, MDagPath& transformPath);
+
+    EvalStats& evalStats() { return m_stats; }
 
 private:
+    struct InputPaths {
+        MDagPath meshPath;
+        MDagPath transformPath;
+        bool articulated;
+    };
+
+    // Resolves the input meshes and bakes the first unskinned one
+    MStatus prepare() override;
+
+    // Elongated positions of vertexIds at frameTime, from m_subframes when frameTime is on the shutter's grid
+    const float* sampleElongatedAt(const FrameStore& frames, const SmoothedOffsets& offsets, const ElongationParams& params,
+        const std::vector<int>& vertexIds, double frameTime, std::vector<float>& scratch);
+    static void inputConnectionChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData);
+    MStatus resolveDagPaths(unsigned int multiIndex, MDagPath& meshPath, MDagPath& transformPath);
+
     MotionOffsetsSimple motionOffsets;
-    bool motionOffsetsBaked;
+    // motionOffsets smoothed over the current window, rebuilt when the window changes
+    SmoothedOffsets smoothedOffsetCache;
+    // Articulated caches are sampled unsmoothed, through a window 0 table over the sampled store
+    SmoothedOffsets m_articulatedOffsets;
+    // The current frame's motion-blur sub-samples
+    SubframeBatch m_subframes;
+
+    // Cache bound through cachePath, held so the registry keeps it loaded
+    CacheRegistry::Handle m_cache;
+    // Pages in m_cache's upcoming frames during playback
+    FramePrefetcher m_prefetcher;
+    // m_cache's frames around the sampled one, when it is compressed
+    FrameWindow m_window;
+    EvalStats m_stats;
 
     bool skinDataBaked;
-    MObject m_skinCluster;
-    MDagPathArray m_influenceBones;
+    // Meshes feeding input[], by multiIndex, resolved by prepare()
+    std::unordered_map<unsigned int, InputPaths> m_inputPaths;
+    MCallbackId m_inputCallback;
+    // Whether the deformed meshes are skinned, resolved once per mesh
+    SkinBinding m_skinBinding;
     std::vector<BoneData> m_boneData;
     std::vector<std::vector<InfluenceData>> vertexWeights;
 
@@ -70,4 +119,6 @@ private:
     double elongationStrengthFuture;
     bool smoothingEnabled;
     int N;
+    // Motion-blur sample times, batched in m_subframes
+    Shutter shutter;
 };
\ No newline at end of file
@@ -14,6 +14,7 @@
 #include <maya/MTime.h>
 #include <maya/MFnNumericAttribute.h>
 #include <maya/MDagPath.h>
+#include <maya/MMessage.h>
 
 #include "smear.h" 
 
@@ -27,13 +28,49 @@ MTypeId SmearNode::id(0x98520); // Random id
 MObject SmearNode::time;
 MObject SmearNode::inputMesh;
 MObject SmearNode::outputMesh;
+StatsAttributes SmearNode::statsAttributes;
 
 SmearNode::SmearNode():
-    motionOffsetsSimple(), motionOffsetsBaked(false) 
+    motionOffsetsSimple(), m_inputCallback(0), inputPointsDirty(true)
 {}
 
 SmearNode::~SmearNode()
-{}
+{
+    if (m_inputCallback != 0)
+        MMessage::removeCallback(m_inputCallback);
+}
+
+void SmearNode::postConstructor()
+{
+    MStatus status;
+    MObject node = thisMObject();
+    MCallbackId id = MNodeMessage::addAttributeChangedCallback(node, inputConnectionChanged, this, &status);
+    if (status)
+        m_inputCallback = id;
+    else
+        MGlobal::displayWarning("SmearNode: could not watch input connections, a reconnected mesh will not be baked");
+}
+
+void SmearNode::inputConnectionChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData)
+{
+    if ((msg & (MNodeMessage::kConnectionMade | MNodeMessage::kConnectionBroken)) && plug.attribute() == inputMesh)
+        PreparedNode::request(static_cast<SmearNode*>(clientData)->thisMObject());
+}
+
+MStatus SmearNode::prepare()
+{
+    MStatus status;
+    MDagPath shapePath, transformPath;
+    status = Smear::getDagPathsFromInputMesh(MObject::kNullObj, MPlug(thisMObject(), inputMesh), transformPath, shapePath);
+    McheckErr(status, "Failed to tranform path and shape path from input object");
+
+    // Baked once; afterwards key edits only re-bake the frames they touched
+    int firstChanged, lastChanged;
+    status = Smear::updateMotionOffsetsSimple(shapePath, transformPath, thisMObject(), motionOffsetsSimple, firstChanged, lastChanged);
+    McheckErr(status, "Failed to compute motion offsets");
+    motionOffsetsSimple.markChanged(firstChanged, lastChanged);
+    return MS::kSuccess;
+}
 
 void* SmearNode::creator()
 {
@@ -61,6 +98,9 @@ MStatus SmearNode::initialize() {
     typedAttr.setStorable(false);
     addAttribute(outputMesh);
 
+    // Read-only profiling outputs, updated after every compute
+    status = statsAttributes.add();
+    CHECK_MSTATUS_AND_RETURN_IT(status);
 
     // Affects relationships
     attributeAffects(time, outputMesh);
@@ -72,12 +112,60 @@ MStatus SmearNode::initialize() {
 MStatus SmearNode::compute(const MPlug& plug, MDataBlock& data) {
     if (plug != outputMesh) return MS::kUnknownParameter;
 
+    MStatus status;
+    {
+        SmearProfilingScope scope("Compute", m_stats.evaluateMs, MProfiler::kColorE_L2);
+        status = computeOutputMesh(plug, data);
+    }
+    ++m_stats.evaluations;
+    statsAttributes.write(data, m_stats);
+    return status;
+}
+
+MStatus SmearNode::setDependentsDirty(const MPlug& plug, MPlugArray& plugArray) {
+    // Time alone leaves the input points as they were, so the output keeps its copy of them
+    if (plug == inputMesh)
+        inputPointsDirty = true;
+    return MPxNode::setDependentsDirty(plug, plugArray);
+}
+
+MStatus SmearNode::preEvaluation(const MDGContext& context, const MEvaluationNode& evaluationNode) {
+    MStatus status;
+    if (context.isNormal() && evaluationNode.dirtyPlugExists(inputMesh, &status) && status)
+        inputPointsDirty = true;
+    return MS::kSuccess;
+}
+
+static bool sameInts(const MIntArray& a, const MIntArray& b)
+{
+    if (a.length() != b.length())
+        return false;
+    for (unsigned int i = 0; i < a.length(); ++i) {
+        if (a[i] != b[i])
+            return false;
+    }
+    return true;
+}
+
+// Same faces over the same vertices as the output was copied with, so its topology is still the input's
+bool SmearNode::sameTopology(const MFnMesh& inputFn, const MFnMesh& outputFn)
+{
+    if (inputFn.numVertices() != outputFn.numVertices() ||
+        inputFn.numPolygons() != static_cast<int>(faceCounts.length()) ||
+        inputFn.numFaceVertices() != static_cast<int>(faceConnects.length()))
+        return false;
+    if (!inputFn.getVertices(inputFaceCounts, inputFaceConnects))
+        return false;
+    return sameInts(inputFaceCounts, faceCounts) && sameInts(inputFaceConnects, faceConnects);
+}
+
+MStatus SmearNode::computeOutputMesh(const MPlug& plug, MDataBlock& data) {
     MStatus status;
 
     // Get time value
     MTime currentTime = data.inputValue(time, &status).asTime();
     McheckErr(status, "Failed to get time value");
-    double frame = currentTime.as(MTime::kFilm);  // Get time in frames
+    double frame = currentTime.as(MTime::uiUnit());  // Scene frame, which indexes the bake
 
     MDataHandle inputHandle = data.inputValue(inputMesh, &status);
     McheckErr(status, "Failed to get input mesh");
@@ -88,40 +176,25 @@ MStatus SmearNode::compute(const MPlug& plug, MDataBlock& data) {
         return MS::kFailure;
     }
 
-    // Create new mesh data
-    MFnMeshData meshData;
-    MObject newOutput = meshData.create(&status);
-    McheckErr(status, "Failed to create output mesh container");
-
-    // Copy mesh using API method
     MFnMesh inputFn(inputObj);
-    MObject copiedMesh = inputFn.copy(inputObj, newOutput, &status);
-    McheckErr(status, "Mesh copy failed");
-
-    // Get DAG paths for mesh and transform
-    MFnDependencyNode thisNodeFn(thisMObject());
-    MPlug inputPlug = thisNodeFn.findPlug(inputMesh, true);
-
-    MDagPath shapePath, transformPath;
-    status = Smear::getDagPathsFromInputMesh(inputObj, inputPlug, transformPath, shapePath);
-    McheckErr(status, "Failed to tranform path and shape path from input object");
-    
-    // Cast copied Mesh into MfnMesh
-    MFnMesh outputFn(copiedMesh, &status);
-    McheckErr(status, "Output mesh init failed");
-
-    const int numVertices = outputFn.numVertices();
+    const int numVertices = inputFn.numVertices();
     if (numVertices == 0) {
         MGlobal::displayError("Mesh has no vertices");
         return MS::kFailure;
     }
 
-    // Compute motion offsets using Smear functions
-    if (!motionOffsetsBaked) {
-        status = Smear::computeMotionOffsetsSimple(shapePath, transformPath, motionOffsetsSimple);
-        McheckErr(status, "Failed to compute motion offsets");
-        motionOffsetsBaked = true;
-    }
+    // Motion offsets are baked by prepare(); a bake in another time unit needs another one
+    const FrameStore& frames = motionOffsetsSimple.frames;
+    if (!hasPrepared() || (!frames.empty() && std::abs(frames.fps() - Smear::sceneFps()) > 1e-6))
+        prepareOrRequest(thisMObject());
+    if (frames.empty())
+        return MS::kSuccess;
+    // Frames prepare() baked again since the last evaluation
+    int firstChanged, lastChanged;
+    motionOffsetsSimple.takeChanged(firstChanged, lastChanged);
+    m_stats.bakeMs = motionOffsetsSimple.bakeMs;
+    m_stats.countLookup(firstChanged > lastChanged);
+    m_stats.residentBytes = motionOffsetsSimple.frames.residentBytes();
 
     int frameIndex = static_cast<int>(frame - motionOffsetsSimple.startFrame);
 
@@ -129,41 +202,83 @@ MStatus SmearNode::compute(const MPlug& plug, MDataBlock& data) {
     //    " Start frame: " + motionOffsetsSimple.startFrame +
     //    " Frame index: " + frameIndex);
 
-    if (frameIndex < 0 || frameIndex >= motionOffsetsSimple.motionOffsets.size()) {
+    if (!motionOffsetsSimple.frames.hasFrame(frameIndex)) {
         return MS::kSuccess;
     }
 
-    MDoubleArray& currentFrameOffsets = motionOffsetsSimple.motionOffsets[frameIndex];
-    if (currentFrameOffsets.length() != numVertices) {
+    const float* currentFrameOffsets = motionOffsetsSimple.frames.offsets(frameIndex);
+    if (motionOffsetsSimple.frames.vertexCount() != numVertices) {
         MGlobal::displayError("Offset/vertex count mismatch");
         return MS::kFailure;
     }
 
-    // Map motion offsets to colors
-    MColorArray colors(numVertices);
-    MIntArray vtxIndices(numVertices);
-
-    for (int i = 0; i < numVertices; ++i) {
-        double offset = currentFrameOffsets[i];
-        colors[i] = computeColor(offset);
-        vtxIndices[i] = i;  
+    // Reuse the mesh already in the output when it still matches the input, copy it otherwise
+    MDataHandle outputHandle = data.outputValue(outputMesh, &status);
+    McheckErr(status, "Failed to get output mesh");
+    MObject outputObj = outputHandle.asMesh();
+    // The input's topology only needs comparing when the input itself changed
+    const bool reuse = !outputObj.isNull() && (!inputPointsDirty || sameTopology(inputFn, MFnMesh(outputObj)));
+    {
+        SmearProfilingScope scope("Update output mesh", m_stats.meshMs);
+        if (!reuse) {
+            // Create new mesh data
+            MFnMeshData meshData;
+            MObject newOutput = meshData.create(&status);
+            McheckErr(status, "Failed to create output mesh container");
+
+            // Copy mesh using API method
+            inputFn.copy(inputObj, newOutput, &status);
+            McheckErr(status, "Mesh copy failed");
+            outputHandle.set(newOutput);
+            outputObj = outputHandle.asMesh();
+            status = inputFn.getVertices(faceCounts, faceConnects);
+            McheckErr(status, "Failed to read input faces");
+        }
+        else if (inputPointsDirty) {
+            status = inputFn.getPoints(pointBuffer);
+            McheckErr(status, "Failed to read input points");
+            status = MFnMesh(outputObj).setPoints(pointBuffer);
+            McheckErr(status, "Failed to update output points");
+        }
     }
+    inputPointsDirty = false;
+
+    MFnMesh outputFn(outputObj, &status);
+    McheckErr(status, "Output mesh init failed");
 
     // Create/update color set
     const MString colorSet("smearSet");
+    if (!reuse) {
+        outputFn.createColorSetWithName(colorSet);
+        outputFn.setCurrentColorSetName(colorSet);
+
+        // A fresh mesh has no colors yet, every vertex gets written below
+        currentColors.setLength(numVertices);
+        colorVertexIds.setLength(numVertices);
+        for (int i = 0; i < numVertices; ++i)
+            colorVertexIds[i] = i;
+    }
 
-    outputFn.createColorSetWithName(colorSet);
-    outputFn.setCurrentColorSetName(colorSet);
+    // Map motion offsets to colors, in the buffer kept from the last frame
+    bool colorsChanged = !reuse;
+    m_stats.verticesProcessed = numVertices;
+    for (int i = 0; i < numVertices; ++i) {
+        const MColor color = computeColor(currentFrameOffsets[i]);
+        if (colorsChanged || currentColors[i] != color) {
+            currentColors[i] = color;
+            colorsChanged = true;
+        }
+    }
 
-    // Apply colors to specific color set
-    status = outputFn.setVertexColors(colors, vtxIndices);
-    McheckErr(status, "Failed to set colors");
+    // Apply colors to specific color set; nothing to upload when no vertex changed color
+    if (colorsChanged) {
+        status = outputFn.setVertexColors(currentColors, colorVertexIds);
+        McheckErr(status, "Failed to set colors");
+    }
 
     // Force viewport update
     outputFn.updateSurface();
 
-    // Set output
-    data.outputValue(outputMesh).set(newOutput);
     data.setClean(plug);
 
     return MS::kSuccess;
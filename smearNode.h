@@ -1,6 +1,13 @@
 #pragma once
 #include <maya/MPxNode.h>
+#include <maya/MColorArray.h>
+#include <maya/MFloatPointArray.h>
+#include <maya/MIntArray.h>
+#include <maya/MEvaluationNode.h>
+#include <maya/MNodeMessage.h>
 #include "smear.h"
+#include "smearStats.h"
+#include "nodePreparation.h"
 
 /*
 	createNode SmearNode;
@@ -13,28 +20,50 @@
 	connectAttr "SmearNode1.outputMesh" "pCube1.inMesh";
 */
 
-class SmearNode : public MPxNode
+class SmearNode : public MPxNode, public PreparedNode
 {
 private: 
 	// Caches motion offsets for simlpe objects. 
 	// TODO: Add a way to cache motion offsets for non-simple objects
 	MotionOffsetsSimple motionOffsetsSimple; 
-	// Tracks whether motion offsets are baked to avoid recomputation of offsets every frame
-	bool motionOffsetsBaked; 
-	
+	EvalStats m_stats;
+	MCallbackId m_inputCallback;
+
+	// The output mesh stays in the datablock between evaluations; while the input's
+	// topology is unchanged only its points (when the input changed) and colors are updated
+	bool inputPointsDirty;
+	MFloatPointArray pointBuffer;
+	// Face counts and connects the output was copied with, and the input's for comparison
+	MIntArray faceCounts, faceConnects;
+	MIntArray inputFaceCounts, inputFaceConnects;
+	MColorArray currentColors; // Used for caching to avoid array reallocation every frame 
+	MIntArray colorVertexIds;
+
+	MStatus computeOutputMesh(const MPlug& plug, MDataBlock& data);
+	bool sameTopology(const MFnMesh& inputFn, const MFnMesh& outputFn);
+	// Bakes the transform feeding inputMesh
+	MStatus prepare() override;
+	static void inputConnectionChanged(MNodeMessage::AttributeMessage msg, MPlug& plug, MPlug& otherPlug, void* clientData);
 
 public:
 	SmearNode();
 	~SmearNode() override;
+	void postConstructor() override;
 	static  void* creator();
 	static  MStatus initialize();
 	MStatus compute(const MPlug& plug, MDataBlock& data) override;
+	// compute only reads what prepare() left behind
+	SchedulingType schedulingType() const override { return PreparedNode::schedulingType(); }
+	// Flag an input points change: setDependentsDirty under the DG, preEvaluation under the Evaluation Manager
+	MStatus setDependentsDirty(const MPlug& plug, MPlugArray& plugArray) override;
+	MStatus preEvaluation(const MDGContext& context, const MEvaluationNode& evaluationNode) override;
 	MColor computeColor(double offset);	
+	EvalStats& evalStats() { return m_stats; }
 
 	static MTypeId id;  // Unique node ID
 	static MObject time; 
 	static MObject inputMesh;  
 	static MObject outputMesh; 
-	static MColorArray currentColors; // Used for caching to avoid array reallocation every frame 
+	static StatsAttributes statsAttributes;
 };
 
@@ -0,0 +1,89 @@
+#include "smearStats.h"
+#include <maya/MFnNumericAttribute.h>
+#include <maya/MPxNode.h>
+
+int SmearProfiler::category = -1;
+double SmearProfiler::cacheLoadMs = 0.0;
+
+void SmearProfiler::registerCategory()
+{
+    category = MProfiler::addCategory("SMEARin", "Smear bake, smoothing, interpolation and mesh output");
+}
+
+void SmearProfiler::deregisterCategory()
+{
+    if (category < 0)
+        return;
+    MProfiler::removeCategory("SMEARin");
+    category = -1;
+}
+
+SmearProfilingScope::SmearProfilingScope(const char* eventName, double& milliseconds, MProfiler::ProfilingColor color)
+    : m_event(SmearProfiler::category, color, eventName),
+      m_timer(milliseconds)
+{}
+
+static MStatus addStat(MObject& attr, const char* name, const char* shortName, MFnNumericData::Type type)
+{
+    MFnNumericAttribute nAttr;
+    MStatus status;
+    attr = nAttr.create(name, shortName, type, 0, &status);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    nAttr.setWritable(false);
+    nAttr.setStorable(false);
+    nAttr.setKeyable(false);
+    return MPxNode::addAttribute(attr);
+}
+
+MStatus StatsAttributes::add()
+{
+    MStatus status;
+    status = addStat(bakeTime, "statBakeTime", "sbt", MFnNumericData::kDouble);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    status = addStat(smoothTime, "statSmoothTime", "sst", MFnNumericData::kDouble);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    status = addStat(interpolateTime, "statInterpolateTime", "sit", MFnNumericData::kDouble);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    status = addStat(meshTime, "statMeshTime", "smt", MFnNumericData::kDouble);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    status = addStat(evaluateTime, "statEvaluateTime", "sevt", MFnNumericData::kDouble);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    status = addStat(evaluations, "statEvaluations", "sevc", MFnNumericData::kInt);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    status = addStat(verticesProcessed, "statVerticesProcessed", "svp", MFnNumericData::kInt);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    status = addStat(cacheHits, "statCacheHits", "sch", MFnNumericData::kInt);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    status = addStat(cacheMisses, "statCacheMisses", "scm", MFnNumericData::kInt);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    // Doubles hold byte counts past 2 GB exactly enough
+    status = addStat(residentBytes, "statResidentBytes", "srb", MFnNumericData::kDouble);
+    CHECK_MSTATUS_AND_RETURN_IT(status);
+    return MS::kSuccess;
+}
+
+static void writeStat(MDataBlock& block, const MObject& attr, double value)
+{
+    block.outputValue(attr).setDouble(value);
+    block.setClean(attr);
+}
+
+static void writeStat(MDataBlock& block, const MObject& attr, int64_t value)
+{
+    block.outputValue(attr).setInt(static_cast<int>(value));
+    block.setClean(attr);
+}
+
+void StatsAttributes::write(MDataBlock& block, const EvalStats& stats) const
+{
+    writeStat(block, bakeTime, stats.bakeMs);
+    writeStat(block, smoothTime, stats.smoothMs);
+    writeStat(block, interpolateTime, stats.interpolateMs);
+    writeStat(block, meshTime, stats.meshMs);
+    writeStat(block, evaluateTime, stats.evaluateMs);
+    writeStat(block, evaluations, stats.evaluations);
+    writeStat(block, verticesProcessed, stats.verticesProcessed);
+    writeStat(block, cacheHits, stats.cacheHits);
+    writeStat(block, cacheMisses, stats.cacheMisses);
+    writeStat(block, residentBytes, static_cast<double>(stats.residentBytes));
+}
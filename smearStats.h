@@ -0,0 +1,56 @@
+#pragma once
+#include <maya/MDataBlock.h>
+#include <maya/MObject.h>
+#include <maya/MProfiler.h>
+#include <maya/MStatus.h>
+#include "evalStats.h"
+
+/*
+Hot-path profiling for the smear nodes. Each timed section feeds the node's
+EvalStats and is also an event in the "SMEARin" category of Maya's Profiler,
+so the numbers in the stat attributes and in "smearStats" line up with what
+the Profiler timeline shows.
+*/
+
+class SmearProfiler
+{
+public:
+    // Called from initializePlugin / uninitializePlugin
+    static void registerCategory();
+    static void deregisterCategory();
+
+    static int category;
+    // Last Smear::loadCache; hits and misses are counted by the CacheRegistry
+    static double cacheLoadMs;
+};
+
+// Times a section into milliseconds and records it as a Profiler event
+class SmearProfilingScope
+{
+public:
+    SmearProfilingScope(const char* eventName, double& milliseconds, MProfiler::ProfilingColor color = MProfiler::kColorE_L1);
+
+private:
+    MProfilingScope m_event;
+    ScopedTimer m_timer;
+};
+
+// Read-only output attributes publishing a node's EvalStats
+struct StatsAttributes
+{
+    MObject bakeTime;
+    MObject smoothTime;
+    MObject interpolateTime;
+    MObject meshTime;
+    MObject evaluateTime;
+    MObject evaluations;
+    MObject verticesProcessed;
+    MObject cacheHits;
+    MObject cacheMisses;
+    MObject residentBytes;
+
+    // Adds the attributes to the node type being initialized
+    MStatus add();
+    // Sets every attribute from stats and marks it clean, called at the end of an evaluation
+    void write(MDataBlock& block, const EvalStats& stats) const;
+};
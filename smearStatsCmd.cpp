@@ -0,0 +1,113 @@
+#include "smearStatsCmd.h"
+#include "smearNode.h"
+#include "smearDeformerNode.h"
+#include "motionLinesNode.h"
+#include "smearStats.h"
+#include <maya/MArgDatabase.h>
+#include <maya/MFnDependencyNode.h>
+#include <maya/MItDependencyNodes.h>
+#include <maya/MObjectArray.h>
+#include <maya/MSelectionList.h>
+#include <maya/MStringArray.h>
+#include <cstdio>
+
+static const char* kResetFlag = "-r";
+static const char* kResetFlagLong = "-reset";
+
+MSyntax SmearStatsCmd::newSyntax()
+{
+    MSyntax syntax;
+    syntax.addFlag(kResetFlag, kResetFlagLong);
+    syntax.setObjectType(MSyntax::kStringObjects, 0);
+    return syntax;
+}
+
+// The stats of a SmearNode, SmearDeformerNode or MotionLinesNode, null for any other node
+static EvalStats* nodeStats(const MObject& node)
+{
+    MFnDependencyNode nodeFn(node);
+    const MTypeId type = nodeFn.typeId();
+    if (type == SmearDeformerNode::id)
+        return &static_cast<SmearDeformerNode*>(nodeFn.userNode())->evalStats();
+    if (type == SmearNode::id)
+        return &static_cast<SmearNode*>(nodeFn.userNode())->evalStats();
+    if (type == MotionLinesNode::id)
+        return &static_cast<MotionLinesNode*>(nodeFn.userNode())->evalStats();
+    return nullptr;
+}
+
+static MString describe(const MString& name, const EvalStats& stats)
+{
+    char line[512];
+    std::snprintf(line, sizeof(line),
+        "%s: evaluate %.3f ms (smooth %.3f, interpolate %.3f, mesh %.3f), last bake %.3f ms, "
+        "%lld vertices, %lld evaluations, %lld hits / %lld misses, %.1f MB resident",
+        name.asChar(), stats.evaluateMs, stats.smoothMs, stats.interpolateMs, stats.meshMs, stats.bakeMs,
+        static_cast<long long>(stats.verticesProcessed), static_cast<long long>(stats.evaluations),
+        static_cast<long long>(stats.cacheHits), static_cast<long long>(stats.cacheMisses),
+        stats.residentBytes / (1024.0 * 1024.0));
+    return line;
+}
+
+static MString describeCacheLoading()
+{
+    char line[256];
+    std::snprintf(line, sizeof(line),
+        "cache loading: last load %.3f ms, %zu hits / %zu misses, %zu caches, %.1f MB",
+        SmearProfiler::cacheLoadMs, CacheRegistry::hitCount(), CacheRegistry::missCount(),
+        CacheRegistry::cacheCount(), CacheRegistry::footprint() / (1024.0 * 1024.0));
+    return line;
+}
+
+MStatus SmearStatsCmd::doIt(const MArgList& args) {
+    MStatus status;
+    MArgDatabase argData(syntax(), args, &status);
+    if (!status) {
+        MGlobal::displayError("Usage: smearStats [-reset] [node ...]");
+        return MS::kFailure;
+    }
+
+    MStringArray names;
+    argData.getObjects(names);
+    const bool allNodes = names.length() == 0;
+
+    MObjectArray nodes;
+    if (allNodes) {
+        for (MItDependencyNodes it; !it.isDone(); it.next()) {
+            MObject node = it.thisNode();
+            if (nodeStats(node))
+                nodes.append(node);
+        }
+    }
+    else {
+        for (unsigned int i = 0; i < names.length(); ++i) {
+            MSelectionList list;
+            MObject node;
+            if (!list.add(names[i]) || !list.getDependNode(0, node) || !nodeStats(node)) {
+                MGlobal::displayError("smearStats: " + names[i] + " is not a smear node");
+                return MS::kFailure;
+            }
+            nodes.append(node);
+        }
+    }
+
+    const bool reset = argData.isFlagSet(kResetFlag);
+    for (unsigned int i = 0; i < nodes.length(); ++i) {
+        EvalStats& stats = *nodeStats(nodes[i]);
+        if (reset)
+            stats.reset();
+        else
+            appendToResult(describe(MFnDependencyNode(nodes[i]).name(), stats));
+    }
+
+    if (allNodes) {
+        if (reset) {
+            SmearProfiler::cacheLoadMs = 0.0;
+            CacheRegistry::resetCounters();
+        }
+        else {
+            appendToResult(describeCacheLoading());
+        }
+    }
+    return MS::kSuccess;
+}
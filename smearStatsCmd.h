@@ -0,0 +1,22 @@
+#pragma once
+#include <maya/MPxCommand.h>
+#include <maya/MArgList.h>
+#include <maya/MGlobal.h>
+#include <maya/MSyntax.h>
+
+/*
+	smearStats;                                      // every smear node, then cache loading
+	smearStats SmearDeformerNode1 MotionLinesNode1;  // just these nodes
+	smearStats -reset;                               // zero the counters (of the named nodes, or all)
+
+	Returns one line per node: where the last evaluation's time went, vertices
+	written, cache hits/misses and resident memory. The same numbers are on each
+	node's read-only stat* attributes and in Maya's Profiler under "SMEARin".
+*/
+
+class SmearStatsCmd : public MPxCommand {
+public:
+    static void* creator() { return new SmearStatsCmd(); }
+    static MSyntax newSyntax();
+    MStatus doIt(const MArgList& args) override;
+};